@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+/**
+ * @brief ê܂ܑMR}hobt@AL[ƂɋL^Ă
+ *
+ * L[͋L^e߂́iǂݏõobt@̃CfbNXȂǁjB
+ * GetŎoR}hobt@L^ς݂Ȃ炻̂܂ܕԂA܂ȂL^ĂԂB
+ * _[^[QbgpCvC蒼ƂInvalidateŋL^B
+ * R}hobt@͑Mt[̊҂ĂĂёM邱ƁiɎgȂj
+ */
+class CommandBufferCache
+{
+public:
+    /**
+     * @param device _foCX
+     * @param pool R}hobt@mۂv[ieResetCommandBufferō쐬́j
+     */
+    void Init(const vk::Device device, const vk::CommandPool pool)
+    {
+        device_ = device;
+        pool_ = pool;
+        entries_.clear();
+        records_ = 0;
+        reuses_ = 0;
+    }
+
+    /**
+     * @brief L[ɑΉL^ς݂̃R}hobt@ԂBL^ȂrecordŋL^
+     * @param key L^e߂L[
+     * @param record R}hobt@󂯎Abeginend܂łL^֐
+     * @param reused L^ς݂̂̂g
+     */
+    template <typename Record>
+    vk::CommandBuffer Get(const uint32_t key, Record&& record, bool& reused)
+    {
+        if (key >= entries_.size())
+        {
+            entries_.resize(key + 1);
+        }
+
+        Entry& entry = entries_[key];
+        if (!entry.cmd_buf)
+        {
+            vk::CommandBufferAllocateInfo cmd_buf_alloc_info;
+            cmd_buf_alloc_info.commandPool = pool_;
+            cmd_buf_alloc_info.commandBufferCount = 1;
+            cmd_buf_alloc_info.level = vk::CommandBufferLevel::ePrimary;
+            entry.cmd_buf = std::move(device_.allocateCommandBuffersUnique(cmd_buf_alloc_info).front());
+        }
+
+        reused = entry.recorded;
+        if (reused)
+        {
+            reuses_++;
+        }
+        else
+        {
+            record(entry.cmd_buf.get());
+            entry.recorded = true;
+            records_++;
+        }
+        return entry.cmd_buf.get();
+    }
+
+    /**
+     * @brief ׂẴR}hobt@AGetŋL^
+     */
+    void Invalidate()
+    {
+        for (Entry& entry : entries_)
+        {
+            entry.recorded = false;
+        }
+    }
+
+    /**
+     * @brief L^
+     */
+    uint64_t Records() const
+    {
+        return records_;
+    }
+
+    /**
+     * @brief L^ɑM
+     */
+    uint64_t Reuses() const
+    {
+        return reuses_;
+    }
+
+private:
+    struct Entry
+    {
+        vk::UniqueCommandBuffer cmd_buf;
+        bool recorded = false;
+    };
+
+    vk::Device device_;
+    vk::CommandPool pool_;
+
+    std::vector<Entry> entries_;
+
+    uint64_t records_ = 0;
+    uint64_t reuses_ = 0;
+};
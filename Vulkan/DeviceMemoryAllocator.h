@@ -0,0 +1,456 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+
+/**
+ * @brief foCX̃TuAP[^
+ *
+ * ^CvƂɑ傫ȃubN܂Ƃ߂ĊmۂA̒C[Wobt@̃؂oB
+ * vkAllocateMemory̌Ăяo񐔁imaxMemoryAllocationCount̐jƃhCõI[o[wbh}邽߁A
+ * ꂽ̈̓t[Xgɖ߂čėpB
+ * ubN̔𒴂悤ȑ傫ȗv̓ubN𕪂ĐpɊmۂB
+ */
+class DeviceMemoryAllocator
+{
+public:
+    /**
+     * @brief mۂ̗̈
+     */
+    struct Allocation
+    {
+        vk::DeviceMemory memory;
+        vk::DeviceSize offset = 0;
+        vk::DeviceSize size = 0;
+        uint32_t memory_type_index = 0;
+
+        // HostVisibleȃȂAiIɃ}bvAhXioffsetKpς݁j
+        void* mapped = nullptr;
+
+        // ؂õubN
+        uint32_t block_index = UINT32_MAX;
+
+        explicit operator bool() const
+        {
+            return block_index != UINT32_MAX;
+        }
+    };
+
+    /**
+     * @brief gp󋵂̓v
+     */
+    struct Statistics
+    {
+        // foCX̊mېiubNjƁÂpɊmۂ̂̐
+        uint32_t block_count = 0;
+        uint32_t dedicated_block_count = 0;
+
+        // ؂ö̐
+        uint32_t allocation_count = 0;
+
+        // hComۂoCgƁÂgp̃oCg
+        vk::DeviceSize reserved_bytes = 0;
+        vk::DeviceSize used_bytes = 0;
+
+        // 󂫗̈̐ƍő̋󂫗̈
+        uint32_t free_range_count = 0;
+        vk::DeviceSize largest_free_range = 0;
+
+        /**
+         * @brief fЉi0: 󂫗̈悪1ɂ܂Ƃ܂ĂA1ɋ߂قǍא؂j
+         */
+        double Fragmentation() const
+        {
+            const vk::DeviceSize free_bytes = reserved_bytes - used_bytes;
+            return free_bytes == 0 ? 0.0 : 1.0 - static_cast<double>(largest_free_range) / static_cast<double>(free_bytes);
+        }
+    };
+
+    /**
+     * @param physical_device foCX
+     * @param device _foCX
+     * @param block_size ubN1̃TCY
+     */
+    void Init(const vk::PhysicalDevice physical_device, const vk::Device device, const vk::DeviceSize block_size = kDefaultBlockSize)
+    {
+        device_ = device;
+        block_size_ = block_size;
+        mem_props_ = physical_device.getMemoryProperties();
+        non_coherent_atom_size_ = physical_device.getProperties().limits.nonCoherentAtomSize;
+    }
+
+    /**
+     * @brief mۂ
+     * @param mem_req \[X̃v
+     * @param memory_type_index gp郁^Cv
+     * @param linear obt@܂̓jA^CÕC[WibufferImageGranularitŷ߁AIveB}ȃC[WƂ̓ubN𕪂j
+     * @return mۂ̈
+     */
+    Allocation Allocate(const vk::MemoryRequirements& mem_req, const uint32_t memory_type_index, const bool linear)
+    {
+        if (!(mem_req.memoryTypeBits & (1u << memory_type_index)))
+        {
+            throw std::runtime_error("Memory type is not allowed for this resource!");
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        vk::DeviceSize alignment = std::max<vk::DeviceSize>(mem_req.alignment, 1);
+        if (IsHostVisible(memory_type_index) && !IsHostCoherent(memory_type_index))
+        {
+            // ׂ̗̈܂Invalidateł悤ɂ
+            alignment = std::max(alignment, non_coherent_atom_size_);
+        }
+
+        // 傫ȗv͐pɊmۂ
+        if (mem_req.size > block_size_ / 2)
+        {
+            const uint32_t block_index = CreateBlock(mem_req.size, memory_type_index, linear, true);
+            Block& block = *blocks_[block_index];
+            block.free_ranges.clear();
+            block.used_bytes = mem_req.size;
+            block.allocation_count = 1;
+
+            return MakeAllocation(block_index, 0, mem_req.size);
+        }
+
+        // ̃ubN̋󂫗̈悩؂o
+        for (uint32_t i = 0; i < blocks_.size(); i++)
+        {
+            Block& block = *blocks_[i];
+            if (!block.memory || block.dedicated || block.memory_type_index != memory_type_index || block.linear != linear)
+            {
+                continue;
+            }
+
+            vk::DeviceSize offset;
+            if (TryAllocateFromBlock(block, mem_req.size, alignment, offset))
+            {
+                return MakeAllocation(i, offset, mem_req.size);
+            }
+        }
+
+        // 󂫂ȂΐVubNmۂ
+        const uint32_t block_index = CreateBlock(block_size_, memory_type_index, linear, false);
+
+        vk::DeviceSize offset;
+        TryAllocateFromBlock(*blocks_[block_index], mem_req.size, alignment, offset);
+        return MakeAllocation(block_index, offset, mem_req.size);
+    }
+
+    /**
+     * @brief B͓̈ubN̋󂫗̈ƌčėp
+     * @param allocation AllocateŊmۂ̈i͖ɂȂj
+     */
+    void Free(Allocation& allocation)
+    {
+        if (!allocation)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Block& block = *blocks_[allocation.block_index];
+        block.used_bytes -= allocation.size;
+        block.allocation_count--;
+
+        if (block.dedicated)
+        {
+            // p̃ubN̓hCo֕Ԃ
+            block.memory.reset();
+            block.mapped = nullptr;
+        }
+        else
+        {
+            InsertFreeRange(block, allocation.offset, allocation.size);
+        }
+
+        allocation = Allocation();
+    }
+
+    /**
+     * @brief C[Wp̃mۂăoCh
+     * @param image C[W
+     * @param properties v郁̋@\
+     * @param linear jA^CÕC[W
+     * @return mۂ̈
+     */
+    Allocation AllocateForImage(const vk::Image image, const vk::MemoryPropertyFlags properties, const bool linear)
+    {
+        const vk::MemoryRequirements mem_req = device_.getImageMemoryRequirements(image);
+        Allocation allocation = Allocate(mem_req, FindMemoryType(mem_req.memoryTypeBits, properties), linear);
+
+        device_.bindImageMemory(image, allocation.memory, allocation.offset);
+        return allocation;
+    }
+
+    /**
+     * @brief obt@p̃mۂăoCh
+     * @param buffer obt@
+     * @param memory_type_index gp郁^Cv
+     * @return mۂ̈
+     */
+    Allocation AllocateForBuffer(const vk::Buffer buffer, const uint32_t memory_type_index)
+    {
+        const vk::MemoryRequirements mem_req = device_.getBufferMemoryRequirements(buffer);
+        Allocation allocation = Allocate(mem_req, memory_type_index, true);
+
+        device_.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+        return allocation;
+    }
+
+    /**
+     * @brief GPU񂾓eCPUǂ߂悤ɂiHostCoherentȃł͉Ȃj
+     * @param allocation ǂݏö
+     */
+    void Invalidate(const Allocation& allocation) const
+    {
+        if (IsHostCoherent(allocation.memory_type_index))
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // ͈͂nonCoherentAtomSize̔{łȂ΂ȂȂ
+        const vk::DeviceSize begin = allocation.offset / non_coherent_atom_size_ * non_coherent_atom_size_;
+        const vk::DeviceSize end = (allocation.offset + allocation.size + non_coherent_atom_size_ - 1) / non_coherent_atom_size_ * non_coherent_atom_size_;
+        const vk::DeviceSize block_size = blocks_[allocation.block_index]->size;
+
+        device_.invalidateMappedMemoryRanges(vk::MappedMemoryRange(allocation.memory, begin, end >= block_size ? VK_WHOLE_SIZE : end - begin));
+    }
+
+    /**
+     * @brief v𖞂^CṽCfbNXԂ
+     * @param request_type_filter v郁^Cv
+     * @param properties ̋@\
+     * @return ̃CfbNX
+     */
+    uint32_t FindMemoryType(const uint32_t request_type_filter, const vk::MemoryPropertyFlags properties) const
+    {
+        for (uint32_t i = 0; i < mem_props_.memoryTypeCount; i++)
+        {
+            if ((request_type_filter & (1u << i)) && (mem_props_.memoryTypes[i].propertyFlags & properties) == properties)
+            {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    bool IsHostVisible(const uint32_t memory_type_index) const
+    {
+        return static_cast<bool>(mem_props_.memoryTypes[memory_type_index].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+    }
+
+    bool IsHostCoherent(const uint32_t memory_type_index) const
+    {
+        return static_cast<bool>(mem_props_.memoryTypes[memory_type_index].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    /**
+     * @brief ݂̎gp󋵂Wv
+     */
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Statistics stats;
+        for (const std::unique_ptr<Block>& block : blocks_)
+        {
+            if (!block->memory)
+            {
+                continue;
+            }
+
+            stats.block_count++;
+            stats.dedicated_block_count += block->dedicated ? 1 : 0;
+            stats.allocation_count += block->allocation_count;
+            stats.reserved_bytes += block->size;
+            stats.used_bytes += block->used_bytes;
+            stats.free_range_count += static_cast<uint32_t>(block->free_ranges.size());
+
+            for (const FreeRange& range : block->free_ranges)
+            {
+                stats.largest_free_range = std::max(stats.largest_free_range, range.size);
+            }
+        }
+
+        return stats;
+    }
+
+    /**
+     * @brief gp󋵂\
+     */
+    void PrintStatistics() const
+    {
+        const Statistics stats = GetStatistics();
+
+        std::cout << "device memory: " << stats.block_count << " blocks (" << stats.dedicated_block_count << " dedicated), "
+            << stats.allocation_count << " allocations" << std::endl;
+        std::cout << "  used/reserved: " << stats.used_bytes / 1024 << " / " << stats.reserved_bytes / 1024 << " KiB" << std::endl;
+        std::cout << "  free ranges: " << stats.free_range_count << ", largest: " << stats.largest_free_range / 1024 << " KiB, fragmentation: "
+            << std::fixed << std::setprecision(3) << stats.Fragmentation() << std::endl;
+        std::cout.unsetf(std::ios_base::floatfield);
+    }
+
+    static constexpr vk::DeviceSize kDefaultBlockSize = 64ull * 1024 * 1024;
+
+private:
+    /**
+     * @brief ubN̋󂫗̈iItZbgɕׂj
+     */
+    struct FreeRange
+    {
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+    };
+
+    /**
+     * @brief xvkAllocateMemoryŊmۂ
+     */
+    struct Block
+    {
+        vk::UniqueDeviceMemory memory;
+        vk::DeviceSize size = 0;
+        uint32_t memory_type_index = 0;
+        bool linear = false;
+        bool dedicated = false;
+
+        // HostVisibleȂiIɃ}bvAhX
+        uint8_t* mapped = nullptr;
+
+        std::vector<FreeRange> free_ranges;
+        vk::DeviceSize used_bytes = 0;
+        uint32_t allocation_count = 0;
+    };
+
+    vk::Device device_;
+    vk::DeviceSize block_size_ = kDefaultBlockSize;
+    vk::PhysicalDeviceMemoryProperties mem_props_;
+    vk::DeviceSize non_coherent_atom_size_ = 1;
+
+    std::vector<std::unique_ptr<Block>> blocks_;
+
+    mutable std::mutex mutex_;
+
+    /**
+     * @brief ubNmۂBς݂̃XbgΎg
+     * @return ubÑCfbNX
+     */
+    uint32_t CreateBlock(const vk::DeviceSize size, const uint32_t memory_type_index, const bool linear, const bool dedicated)
+    {
+        auto block = std::make_unique<Block>();
+        block->memory = device_.allocateMemoryUnique(vk::MemoryAllocateInfo(size, memory_type_index));
+        block->size = size;
+        block->memory_type_index = memory_type_index;
+        block->linear = linear;
+        block->dedicated = dedicated;
+        block->free_ranges.push_back({ 0, size });
+
+        if (IsHostVisible(memory_type_index))
+        {
+            // ̉ɈÖقɃA}bv̂ŁAIȃA}bv͍sȂ
+            block->mapped = static_cast<uint8_t*>(device_.mapMemory(block->memory.get(), 0, VK_WHOLE_SIZE));
+        }
+
+        for (uint32_t i = 0; i < blocks_.size(); i++)
+        {
+            if (!blocks_[i]->memory)
+            {
+                blocks_[i] = std::move(block);
+                return i;
+            }
+        }
+
+        blocks_.push_back(std::move(block));
+        return static_cast<uint32_t>(blocks_.size() - 1);
+    }
+
+    /**
+     * @brief ubN̋󂫗̈悩ŏɎ܂ꏊ؂oit@[XgtBbgj
+     * @param offset ؂ö̃ItZbg
+     * @return ؂o
+     */
+    static bool TryAllocateFromBlock(Block& block, const vk::DeviceSize size, const vk::DeviceSize alignment, vk::DeviceSize& offset)
+    {
+        for (size_t i = 0; i < block.free_ranges.size(); i++)
+        {
+            const FreeRange range = block.free_ranges[i];
+            const vk::DeviceSize aligned_offset = (range.offset + alignment - 1) / alignment * alignment;
+            const vk::DeviceSize padding = aligned_offset - range.offset;
+
+            if (range.size < padding || range.size - padding < size)
+            {
+                continue;
+            }
+
+            // O̗]󂫗̈ƂĎc
+            const FreeRange head = { range.offset, padding };
+            const FreeRange tail = { aligned_offset + size, range.size - padding - size };
+
+            block.free_ranges.erase(block.free_ranges.begin() + i);
+            if (tail.size > 0)
+            {
+                block.free_ranges.insert(block.free_ranges.begin() + i, tail);
+            }
+            if (head.size > 0)
+            {
+                block.free_ranges.insert(block.free_ranges.begin() + i, head);
+            }
+
+            block.used_bytes += size;
+            block.allocation_count++;
+            offset = aligned_offset;
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief 󂫗̈ItZbgɑ}Aאڂ󂫗̈ƌ
+     */
+    static void InsertFreeRange(Block& block, const vk::DeviceSize offset, const vk::DeviceSize size)
+    {
+        auto it = std::lower_bound(block.free_ranges.begin(), block.free_ranges.end(), offset,
+            [](const FreeRange& range, const vk::DeviceSize value) { return range.offset < value; });
+        it = block.free_ranges.insert(it, { offset, size });
+
+        // ƌ
+        if (it + 1 != block.free_ranges.end() && it->offset + it->size == (it + 1)->offset)
+        {
+            it->size += (it + 1)->size;
+            block.free_ranges.erase(it + 1);
+        }
+
+        // Oƌ
+        if (it != block.free_ranges.begin() && (it - 1)->offset + (it - 1)->size == it->offset)
+        {
+            (it - 1)->size += it->size;
+            block.free_ranges.erase(it);
+        }
+    }
+
+    Allocation MakeAllocation(const uint32_t block_index, const vk::DeviceSize offset, const vk::DeviceSize size) const
+    {
+        const Block& block = *blocks_[block_index];
+
+        Allocation allocation;
+        allocation.memory = block.memory.get();
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.memory_type_index = block.memory_type_index;
+        allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+        allocation.block_index = block_index;
+        return allocation;
+    }
+};
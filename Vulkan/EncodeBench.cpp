@@ -0,0 +1,726 @@
+// 摜GR[_istb_image_writejSIMDłƃXJ[ŁAdeflateƒdeflateACRC32Adler32̎rx`}[N
+// BMP1f̏oi̎jƁAsƂSIMD̕בւr
+// JPEG͐FϊADCTAʎqSIMDłƃXJ[ŁAX^[g}[J[ŋ؂̃Ggs[ƒr
+// PNG̓ɂ܂Ƃ߂č@ƁAIDAToXg[~Ȏxƃq[vgpʂ̃s[Nr
+// VulkangȂ̂ŁAVulkan SDKȂłrhĎsł
+
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <random>
+#include <atomic>
+
+namespace HeapUsage
+{
+    // stb_image_writemۂĂoCgƁAResetPeak̂̍ől
+    std::atomic<size_t> current{ 0 };
+    std::atomic<size_t> peak{ 0 };
+
+    // mۂ̐擪ɑ傫uĂAƍĊmۂ̂Ƃɍ
+    constexpr size_t kHeader = 16;
+
+    void Add(const size_t size)
+    {
+        const size_t now = current += size;
+        size_t old_peak = peak;
+        while (now > old_peak && !peak.compare_exchange_weak(old_peak, now))
+        {
+        }
+    }
+
+    void* Allocate(const size_t size)
+    {
+        unsigned char* block = static_cast<unsigned char*>(std::malloc(size + kHeader));
+        if (!block)
+        {
+            return nullptr;
+        }
+        std::memcpy(block, &size, sizeof(size));
+        Add(size);
+        return block + kHeader;
+    }
+
+    void Free(void* pointer)
+    {
+        if (!pointer)
+        {
+            return;
+        }
+        unsigned char* block = static_cast<unsigned char*>(pointer) - kHeader;
+        size_t size;
+        std::memcpy(&size, block, sizeof(size));
+        current -= size;
+        std::free(block);
+    }
+
+    void* Reallocate(void* pointer, const size_t size)
+    {
+        if (!pointer)
+        {
+            return Allocate(size);
+        }
+        unsigned char* block = static_cast<unsigned char*>(pointer) - kHeader;
+        size_t old_size;
+        std::memcpy(&old_size, block, sizeof(old_size));
+        block = static_cast<unsigned char*>(std::realloc(block, size + kHeader));
+        if (!block)
+        {
+            return nullptr;
+        }
+        std::memcpy(block, &size, sizeof(size));
+        current -= old_size;
+        Add(size);
+        return block + kHeader;
+    }
+
+    void ResetPeak()
+    {
+        peak = current.load();
+    }
+}
+
+#define STBIW_MALLOC(sz) HeapUsage::Allocate(sz)
+#define STBIW_REALLOC(p, newsz) HeapUsage::Reallocate(p, newsz)
+#define STBIW_FREE(p) HeapUsage::Free(p)
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+#include "ParallelFor.h"
+
+namespace
+{
+    const char* const kSimdLevelNames[] = { "scalar", "sse2/neon", "avx2" };
+
+    // `挋ʂƓRGBA
+    constexpr int kComp = 4;
+
+    /**
+     * @brief x`}[N̐ݒ
+     */
+    struct BenchOptions
+    {
+        // v𑜓xi--sizew肵Ȃ1080pA4KA8Kj
+        std::vector<std::pair<int, int>> sizes;
+
+        uint32_t iterations = 3;
+
+        // deflatẽXbhiĂяoXbh܂ށj
+        uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
+
+        // stbi_write_png_compression_level
+        int level = 8;
+
+        // JPEG̕iistbi_write_jpgqualityj
+        int quality = 90;
+    };
+
+    /**
+     * @brief _Oʂɋ߂摜iOf[V̔wiAPF̎Op`Aʂ̃mCYj
+     * @param width 
+     * @param height 
+     */
+    std::vector<unsigned char> MakeImage(const int width, const int height)
+    {
+        std::vector<unsigned char> image(size_t(width) * height * kComp);
+        uint32_t seed = 12345;
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                // ʒ̏̎Op`
+                const int64_t w = width;
+                const int64_t h = height;
+                const bool inside = y * 2 >= h / 4 && x * 2 * h + y * w >= w * h && (w - x) * 2 * h + y * w >= w * h;
+
+                for (int c = 0; c < kComp; c++)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    const int noise = static_cast<int>(seed >> 29) - 4;
+                    const int value = inside ? 200 - c * 60 : static_cast<int>((x * 255ll / width + y * 255ll / height) / 2) + noise;
+                    image[(size_t(y) * width + x) * kComp + c] = static_cast<unsigned char>(std::clamp(value, 0, 255));
+                }
+            }
+        }
+        return image;
+    }
+
+    /**
+     * @brief ׂĂ̍sƃtB^ɂāASIMDł̃tB^ʂƕ]lXJ[łƈv邩ׂ
+     */
+    bool CheckFilters(const std::vector<unsigned char>& image, const int width, const int height, const int simd_level)
+    {
+        const int row_size = width * kComp;
+        std::vector<signed char> reference(row_size);
+        std::vector<signed char> line(row_size);
+        unsigned char* const pixels = const_cast<unsigned char*>(image.data());
+
+        for (int y = 0; y < height; y++)
+        {
+            for (int filter = 0; filter < 5; filter++)
+            {
+                stbiw__encode_png_line(pixels, row_size, width, height, y, kComp, filter, reference.data(), 0);
+                stbiw__encode_png_line(pixels, row_size, width, height, y, kComp, filter, line.data(), simd_level);
+
+                if (line != reference ||
+                    stbiw__png_line_cost(0, reference.data(), row_size) != stbiw__png_line_cost(simd_level, line.data(), row_size))
+                {
+                    std::cout << "  " << kSimdLevelNames[simd_level] << ": row " << y << " filter " << filter << " differs from scalar" << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief kAtB^̎sƑI̎Ԃ𑪂istbi_write_png_to_mem̍sƂ̏Ɠj
+     * @return 1񂠂̕ώԁibj
+     */
+    double MeasureFiltering(const std::vector<unsigned char>& image, const int width, const int height, const int simd_level, const uint32_t iterations)
+    {
+        const int row_size = width * kComp;
+        std::vector<signed char> line(row_size);
+        unsigned char* const pixels = const_cast<unsigned char*>(image.data());
+        int64_t total_cost = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            for (int y = 0; y < height; y++)
+            {
+                for (int filter = 0; filter < 5; filter++)
+                {
+                    stbiw__encode_png_line(pixels, row_size, width, height, y, kComp, filter, line.data(), simd_level);
+                    total_cost += stbiw__png_line_cost(simd_level, line.data(), row_size);
+                }
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        // œKŏƏȂ悤Ɍʂg
+        if (total_cost < 0)
+        {
+            std::cout << total_cost << std::endl;
+        }
+        return seconds;
+    }
+
+    /**
+     * @brief `FbNT̊֐iCRC32͔]ÕWX^AAdler32͏Ԃ󂯎ĕԂj
+     */
+    struct ChecksumFunc
+    {
+        const char* name;
+        unsigned int (*func)(const unsigned char* data, int length);
+    };
+
+    unsigned int Crc32Bytes(const unsigned char* data, const int length)
+    {
+        return ~stbiw__crc32_bytes(~0u, data, length);
+    }
+
+    unsigned int Crc32Slice8(const unsigned char* data, const int length)
+    {
+        return ~stbiw__crc32_slice8(~0u, data, length);
+    }
+
+#ifdef STBIW__PCLMUL
+    unsigned int Crc32Pclmul(const unsigned char* data, const int length)
+    {
+        // 16̔{64oCgȏゾ܂Ƃ߂ďAc1oCg
+        const int folded = length >= 64 ? length & ~15 : 0;
+        const unsigned int crc = folded ? stbiw__crc32_pclmul(~0u, data, folded) : ~0u;
+        return ~stbiw__crc32_bytes(crc, data + folded, length - folded);
+    }
+#endif
+
+    unsigned int Crc32Dispatch(const unsigned char* data, const int length)
+    {
+        return stbiw__crc32(const_cast<unsigned char*>(data), length);
+    }
+
+    unsigned int Adler32Scalar(const unsigned char* data, const int length)
+    {
+        return stbiw__adler32_scalar(1, data, length);
+    }
+
+#ifdef STBIW__SSE2
+    unsigned int Adler32Sse2(const unsigned char* data, const int length)
+    {
+        int tail = length;
+        const unsigned int adler = stbiw__adler32_sse2(1, data, &tail);
+        return stbiw__adler32_scalar(adler, data + (length - tail), tail);
+    }
+#endif
+
+#ifdef STBIW__AVX2
+    unsigned int Adler32Avx2(const unsigned char* data, const int length)
+    {
+        int tail = length;
+        const unsigned int adler = stbiw__adler32_avx2(1, data, &tail);
+        return stbiw__adler32_scalar(adler, data + (length - tail), tail);
+    }
+#endif
+
+#ifdef STBIW__NEON
+    unsigned int Adler32Neon(const unsigned char* data, const int length)
+    {
+        int tail = length;
+        const unsigned int adler = stbiw__adler32_neon(1, data, &tail);
+        return stbiw__adler32_scalar(adler, data + (length - tail), tail);
+    }
+#endif
+
+    unsigned int Adler32Dispatch(const unsigned char* data, const int length)
+    {
+        return stbiw__adler32(const_cast<unsigned char*>(data), length);
+    }
+
+    /**
+     * @brief ̃obt@ŁAěʂ̎i擪̊֐jƈv邩ׁAx𑪂
+     * @param label \閼O
+     * @param funcs riCPUΉĂȂ̂͊܂߂Ȃj
+     * @return ׂĈv
+     */
+    bool CheckChecksums(const char* label, const std::vector<ChecksumFunc>& funcs, const std::vector<unsigned char>& buffer, const uint32_t iterations)
+    {
+        // ͕̋ځi16, 64, 1024, 5552j̑OƗAJnʒu͑ĂȂ̂܂߂
+        std::mt19937 rng(1);
+        std::vector<int> lengths = { 0, 1, 15, 16, 17, 63, 64, 65, 1023, 1024, 1025, 5551, 5552, 5553, 11105, 65536 };
+        for (int i = 0; i < 200; i++)
+        {
+            lengths.push_back(static_cast<int>(rng() % 100000));
+        }
+
+        for (const int length : lengths)
+        {
+            for (int offset = 0; offset < 8; offset++)
+            {
+                const unsigned int expected = funcs[0].func(buffer.data() + offset, length);
+                for (const ChecksumFunc& f : funcs)
+                {
+                    if (f.func(buffer.data() + offset, length) != expected)
+                    {
+                        std::cout << "  " << label << " " << f.name << ": length " << length << " offset " << offset << " differs" << std::endl;
+                        return false;
+                    }
+                }
+            }
+        }
+
+        const double megabytes = double(buffer.size()) / (1024.0 * 1024.0);
+        std::cout << "  " << label << ":";
+        for (const ChecksumFunc& f : funcs)
+        {
+            // 1ڂ͌vȂiNbN̗オȂǁj
+            unsigned int result = f.func(buffer.data(), static_cast<int>(buffer.size()));
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < iterations; i++)
+            {
+                result ^= f.func(buffer.data(), static_cast<int>(buffer.size()));
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+            std::cout << " " << f.name << " " << std::fixed << std::setprecision(0) << megabytes / seconds << " MB/s" << (result == 1 ? " " : "");
+        }
+        std::cout << std::endl;
+        return true;
+    }
+
+    /**
+     * @brief 8x8ubNŁASIMDłDCTƗʎq̌ʂXJ[ł1ʎqXebvȓňv邩ׂ
+     * @param mismatches 1XebvꂽW̐
+     * @return ׂ1Xebvȓ
+     */
+    bool CheckJpegCoefficients(const int simd_level, int& mismatches)
+    {
+        // s̊Ԋu̓TuTvOYƓ16܂߂
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> sample(-128.0f, 127.0f);
+        std::uniform_real_distribution<float> step(1.0f / 2048.0f, 1.0f / 8.0f);
+
+        mismatches = 0;
+        for (int block = 0; block < 20000; block++)
+        {
+            const int du_stride = block % 2 ? 16 : 8;
+            float input[8 * 16];
+            float fdtbl[64];
+            for (float& value : input)
+            {
+                value = sample(rng);
+            }
+            for (float& value : fdtbl)
+            {
+                value = step(rng);
+            }
+
+            // XJ[ł̓ubN̏ŏ̂ŁARs[n
+            float scalar_input[8 * 16];
+            std::memcpy(scalar_input, input, sizeof(input));
+
+            int reference[64];
+            int coefficients[64];
+            stbiw__jpg_fdct_quantize(0, scalar_input, du_stride, fdtbl, reference);
+            stbiw__jpg_fdct_quantize(simd_level, input, du_stride, fdtbl, coefficients);
+
+            for (int i = 0; i < 64; i++)
+            {
+                const int difference = std::abs(coefficients[i] - reference[i]);
+                if (difference > 1)
+                {
+                    std::cout << "  " << kSimdLevelNames[simd_level] << ": jpeg block " << block << " coefficient " << i
+                        << " is " << coefficients[i] << ", scalar " << reference[i] << std::endl;
+                    return false;
+                }
+                mismatches += difference;
+            }
+        }
+        return true;
+    }
+
+    void AppendToVector(void* context, void* data, const int size)
+    {
+        std::vector<unsigned char>& output = *static_cast<std::vector<unsigned char>*>(context);
+        output.insert(output.end(), static_cast<unsigned char*>(data), static_cast<unsigned char*>(data) + size);
+    }
+
+    /**
+     * @brief BMP̉foԂ𑪂
+     * @param simd_level gSIMD̃xi-1Ȃ1fo̎j
+     * @param seconds 1񂠂̕ώԁibj
+     * @return ofiwb_j
+     */
+    std::vector<unsigned char> WriteBmpPixels(const std::vector<unsigned char>& image, const int width, const int height, const int simd_level, const uint32_t iterations, double& seconds)
+    {
+        std::vector<unsigned char> bmp;
+        bmp.reserve(image.size() + 1024);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            bmp.clear();
+            stbi__write_context s = {};
+            stbi__start_write_callbacks(&s, AppendToVector, &bmp);
+
+            // stbi_write_bmp_coreRGBAiv4wb_j̏ꍇƓ
+            void* const data = const_cast<unsigned char*>(image.data());
+            if (simd_level < 0)
+            {
+                stbiw__write_pixels_slow(&s, -1, -1, width, height, kComp, data, 1, 0, 1);
+            }
+            else
+            {
+                stbi_write_simd_level = simd_level;
+                stbiw__write_pixels(&s, -1, -1, width, height, kComp, data, 1, 0, 1);
+                stbi_write_simd_level = -1;
+            }
+            stbiw__write_flush(&s);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+        return bmp;
+    }
+
+    /**
+     * @brief JPEGɃGR[h
+     * @param simd_level gSIMD̃x
+     * @param workers тƂ̕GR[hɎg[J[inullptrȂ璀ŁAX^[g}[J[Ȃj
+     * @param seconds 1񂠂̕ώԁibj
+     */
+    std::vector<unsigned char> EncodeJpeg(const std::vector<unsigned char>& image, const int width, const int height, const int quality, const int simd_level, ParallelFor* workers, const uint32_t iterations, double& seconds)
+    {
+        stbi_write_simd_level = simd_level;
+        stbi_write_set_parallel_for(workers ? ParallelFor::Invoke : nullptr, workers);
+
+        std::vector<unsigned char> jpeg;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            jpeg.clear();
+            if (!stbi_write_jpg_to_func(AppendToVector, &jpeg, width, height, kComp, image.data(), quality))
+            {
+                throw std::runtime_error("stbi_write_jpg_to_func failed!");
+            }
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        stbi_write_simd_level = -1;
+        stbi_write_set_parallel_for(nullptr, nullptr);
+        return jpeg;
+    }
+
+    /**
+     * @brief PNGɃGR[h
+     * @param workers deflateɎg[J[inullptrȂ璀j
+     * @param seconds 1񂠂̕ώԁibj
+     */
+    std::vector<unsigned char> EncodePng(const std::vector<unsigned char>& image, const int width, const int height, ParallelFor* workers, const uint32_t iterations, double& seconds)
+    {
+        stbi_write_set_parallel_for(workers ? ParallelFor::Invoke : nullptr, workers);
+
+        std::vector<unsigned char> png;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            int length = 0;
+            unsigned char* data = stbi_write_png_to_mem(image.data(), 0, width, height, kComp, &length);
+            if (!data)
+            {
+                throw std::runtime_error("stbi_write_png_to_mem failed!");
+            }
+            png.assign(data, data + length);
+            STBIW_FREE(data);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        stbi_write_set_parallel_for(nullptr, nullptr);
+        return png;
+    }
+
+    /**
+     * @brief stbi_write_png_to_funcIDAToԂƁAstb_image_writẽq[vgpʂ̃s[N𑪂
+     * @param peak_bytes 1񂠂̃q[vgpʂ̃s[NioCgj
+     */
+    std::vector<unsigned char> StreamPng(const std::vector<unsigned char>& image, const int width, const int height, ParallelFor* workers, const uint32_t iterations, double& seconds, size_t& peak_bytes)
+    {
+        stbi_write_set_parallel_for(workers ? ParallelFor::Invoke : nullptr, workers);
+
+        std::vector<unsigned char> png;
+        peak_bytes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < iterations; i++)
+        {
+            png.clear();
+            HeapUsage::ResetPeak();
+            if (!stbi_write_png_to_func(AppendToVector, &png, width, height, kComp, image.data(), 0))
+            {
+                throw std::runtime_error("stbi_write_png_to_func failed!");
+            }
+            peak_bytes = std::max(peak_bytes, HeapUsage::peak.load() - HeapUsage::current.load());
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+        stbi_write_set_parallel_for(nullptr, nullptr);
+        return png;
+    }
+
+    bool ParseOptions(int argc, char* argv[], BenchOptions& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--size" && i + 1 < argc)
+            {
+                int width = 0;
+                int height = 0;
+                if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+                {
+                    std::cerr << "--size expects WxH" << std::endl;
+                    return false;
+                }
+                options.sizes.emplace_back(width, height);
+            }
+            else if (arg == "--iterations" && i + 1 < argc)
+            {
+                options.iterations = std::max(1, std::atoi(argv[++i]));
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                options.threads = std::max(1, std::atoi(argv[++i]));
+            }
+            else if (arg == "--level" && i + 1 < argc)
+            {
+                options.level = std::atoi(argv[++i]);
+            }
+            else if (arg == "--quality" && i + 1 < argc)
+            {
+                options.quality = std::atoi(argv[++i]);
+            }
+            else
+            {
+                std::cerr << "usage: " << argv[0] << " [--size WxH]... [--iterations N] [--threads N] [--level N] [--quality N]" << std::endl;
+                return false;
+            }
+        }
+
+        if (options.sizes.empty())
+        {
+            options.sizes = { { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        // ܂߂Ă̂ŁAwb_CPÛ܂܎g
+        const int max_level = std::min(stbiw__detect_simd_level(), 2);
+
+        stbi_write_png_compression_level = options.level;
+
+        ParallelFor workers;
+        workers.Start(options.threads);
+
+        std::cout << options.iterations << " iterations, cpu supports " << kSimdLevelNames[max_level]
+            << ", deflate level " << options.level << " on " << workers.ThreadCount() << " threads"
+            << " (" << stbi_write_zlib_chunk_size / 1024 << "K chunks)" << std::endl;
+
+        bool identical = true;
+
+        // CRC32Adler32: 1oCg̕\i̎jƃXJ[Adler32ɂ
+        {
+            std::vector<unsigned char> buffer(32 * 1024 * 1024);
+            std::mt19937 rng(2);
+            for (unsigned char& c : buffer)
+            {
+                c = static_cast<unsigned char>(rng());
+            }
+
+            std::vector<ChecksumFunc> crc_funcs = { { "bytes", Crc32Bytes }, { "slice8", Crc32Slice8 } };
+#ifdef STBIW__PCLMUL
+            if (stbiw__cpu_has_pclmul())
+            {
+                crc_funcs.push_back({ "pclmul", Crc32Pclmul });
+            }
+#endif
+            crc_funcs.push_back({ "dispatch", Crc32Dispatch });
+
+            std::vector<ChecksumFunc> adler_funcs = { { "scalar", Adler32Scalar } };
+#ifdef STBIW__SSE2
+            adler_funcs.push_back({ "sse2", Adler32Sse2 });
+#endif
+#ifdef STBIW__AVX2
+            if (max_level >= 2)
+            {
+                adler_funcs.push_back({ "avx2", Adler32Avx2 });
+            }
+#endif
+#ifdef STBIW__NEON
+            adler_funcs.push_back({ "neon", Adler32Neon });
+#endif
+            adler_funcs.push_back({ "dispatch", Adler32Dispatch });
+
+            std::cout << "checksums (32 MB)" << std::endl;
+            identical = CheckChecksums("crc32", crc_funcs, buffer, options.iterations) && identical;
+            identical = CheckChecksums("adler32", adler_funcs, buffer, options.iterations) && identical;
+        }
+
+        // JPEGDCTƗʎq: WXJ[ł1Xebv傫Ȃ
+        std::cout << "jpeg coefficients (20000 blocks)";
+        for (int level = 1; level <= max_level; level++)
+        {
+            int mismatches = 0;
+            const bool within_one_step = CheckJpegCoefficients(level, mismatches);
+            identical = within_one_step && identical;
+            std::cout << ", " << kSimdLevelNames[level] << " " << (within_one_step ? std::to_string(mismatches) + " off by one" : "too far");
+        }
+        std::cout << std::endl;
+
+        for (const auto& [width, height] : options.sizes)
+        {
+            const std::vector<unsigned char> image = MakeImage(width, height);
+            const double megabytes = double(image.size()) / (1024.0 * 1024.0);
+
+            std::cout << width << "x" << height << std::fixed << std::setprecision(2) << std::endl;
+
+            // stB^: SIMDxƂ̎ԂƁAʂXJ[łƈv邩
+            const double scalar_filter_seconds = MeasureFiltering(image, width, height, 0, options.iterations);
+            std::cout << "  filtering: scalar " << scalar_filter_seconds * 1000.0 << " ms";
+            for (int level = 1; level <= max_level; level++)
+            {
+                const double seconds = MeasureFiltering(image, width, height, level, options.iterations);
+                std::cout << ", " << kSimdLevelNames[level] << " " << seconds * 1000.0 << " ms (x" << scalar_filter_seconds / seconds << ")";
+                identical = CheckFilters(image, width, height, level) && identical;
+            }
+            std::cout << std::endl;
+
+            // BMP: 1f̏oƁASIMDxƂ̍sPʂ̏o
+            double per_pixel_seconds = 0.0;
+            const std::vector<unsigned char> per_pixel_bmp = WriteBmpPixels(image, width, height, -1, options.iterations, per_pixel_seconds);
+            std::cout << "  bmp: per pixel " << megabytes / per_pixel_seconds << " MB/s";
+            for (int level = 0; level <= max_level; level++)
+            {
+                double seconds = 0.0;
+                const std::vector<unsigned char> bmp = WriteBmpPixels(image, width, height, level, options.iterations, seconds);
+                const bool same = bmp == per_pixel_bmp;
+                identical = same && identical;
+                std::cout << ", " << kSimdLevelNames[level] << " rows " << megabytes / seconds << " MB/s (x" << per_pixel_seconds / seconds << (same ? ")" : ", differs!)");
+            }
+            std::cout << std::endl;
+
+            // deflate: ƕiSIMDx͍őj
+            double serial_seconds = 0.0;
+            const std::vector<unsigned char> serial = EncodePng(image, width, height, nullptr, options.iterations, serial_seconds);
+
+            double parallel_seconds = 0.0;
+            const std::vector<unsigned char> parallel = EncodePng(image, width, height, &workers, options.iterations, parallel_seconds);
+
+            std::cout << "  png: serial " << serial_seconds * 1000.0 << " ms (" << megabytes / serial_seconds << " MB/s, " << serial.size() << " bytes)"
+                << ", " << workers.ThreadCount() << " threads " << parallel_seconds * 1000.0 << " ms (" << megabytes / parallel_seconds << " MB/s, x"
+                << serial_seconds / parallel_seconds << ", " << parallel.size() << " bytes, "
+                << std::showpos << (double(parallel.size()) / serial.size() - 1.0) * 100.0 << std::noshowpos << "%)" << std::endl;
+
+            // PNG: ɂ܂Ƃ߂čꍇƃXg[~Õq[vgpʂ̃s[Niǂj
+            double in_memory_seconds = 0.0;
+            HeapUsage::ResetPeak();
+            EncodePng(image, width, height, &workers, 1, in_memory_seconds);
+            const size_t in_memory_peak = HeapUsage::peak - HeapUsage::current;
+
+            double stream_seconds = 0.0;
+            size_t stream_peak = 0;
+            const std::vector<unsigned char> stream = StreamPng(image, width, height, &workers, options.iterations, stream_seconds, stream_peak);
+
+            std::cout << "  png stream: " << stream_seconds * 1000.0 << " ms (" << megabytes / stream_seconds << " MB/s, " << stream.size() << " bytes)"
+                << ", peak heap " << stream_peak / 1024.0 / 1024.0 << " MB vs " << in_memory_peak / 1024.0 / 1024.0 << " MB in memory" << std::endl;
+
+            // JPEG: SIMDxƂ̃KsNZbƁAo͂XJ[łƓoCgɂȂ邩
+            const double megapixels = double(width) * height / 1e6;
+            double scalar_jpeg_seconds = 0.0;
+            const std::vector<unsigned char> scalar_jpeg = EncodeJpeg(image, width, height, options.quality, 0, nullptr, options.iterations, scalar_jpeg_seconds);
+            std::cout << "  jpeg q" << options.quality << ": scalar " << megapixels / scalar_jpeg_seconds << " MP/s (" << scalar_jpeg.size() << " bytes)";
+            for (int level = 1; level <= max_level; level++)
+            {
+                double seconds = 0.0;
+                const std::vector<unsigned char> jpeg = EncodeJpeg(image, width, height, options.quality, level, nullptr, options.iterations, seconds);
+                std::cout << ", " << kSimdLevelNames[level] << " " << megapixels / seconds << " MP/s (x" << scalar_jpeg_seconds / seconds << ", "
+                    << (jpeg == scalar_jpeg ? "identical" : "differs") << ")";
+            }
+            std::cout << std::endl;
+
+            // JPEG: ƁAтƂ̕iSIMDx͍őjBł̓X^[g}[J[̕傫Ȃ
+            double serial_jpeg_seconds = 0.0;
+            const std::vector<unsigned char> serial_jpeg = EncodeJpeg(image, width, height, options.quality, max_level, nullptr, options.iterations, serial_jpeg_seconds);
+
+            double parallel_jpeg_seconds = 0.0;
+            const std::vector<unsigned char> parallel_jpeg = EncodeJpeg(image, width, height, options.quality, max_level, &workers, options.iterations, parallel_jpeg_seconds);
+
+            std::cout << "  jpeg bands of " << stbi_write_jpg_band_rows << " MCU rows: serial " << megapixels / serial_jpeg_seconds << " MP/s"
+                << ", " << workers.ThreadCount() << " threads " << megapixels / parallel_jpeg_seconds << " MP/s (x" << serial_jpeg_seconds / parallel_jpeg_seconds
+                << ", " << parallel_jpeg.size() << " bytes, " << std::showpos << (double(parallel_jpeg.size()) / serial_jpeg.size() - 1.0) * 100.0 << std::noshowpos << "%)" << std::endl;
+        }
+
+        std::cout << (identical ? "all SIMD filter, checksum and bmp outputs identical to scalar, jpeg coefficients within one step" : "SIMD output differs from scalar!") << std::endl;
+        return identical ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstdint>
+#include <algorithm>
+
+/**
+ * @brief 摜̃GR[hƏos[J[Xbh̃v[
+ *
+ * Submit^XN̓L[ɐς܂A󂢂Ă郏[J[ɎsB
+ * L[ɐς߂̂queue_depth܂łŁAς̂ƂSubmit͋󂫂ł܂ő҂i`惋[vւ̃obNvbV[jB
+ * [J[0̏ꍇ́ASubmitĂ񂾃Xbhł̂܂܎s
+ */
+class EncoderPool
+{
+public:
+    EncoderPool() = default;
+
+    EncoderPool(const EncoderPool&) = delete;
+    EncoderPool& operator=(const EncoderPool&) = delete;
+
+    ~EncoderPool()
+    {
+        Stop();
+    }
+
+    /**
+     * @brief [J[XbhN
+     * @param thread_count [J[̐i0ȂSubmitXbhŎsj
+     * @param queue_depth s҂̃^XNς߂鐔i1ȏj
+     */
+    void Start(const uint32_t thread_count, const uint32_t queue_depth)
+    {
+        Stop();
+
+        queue_depth_ = std::max<uint32_t>(queue_depth, 1);
+        stopping_ = false;
+        submit_stalls_ = 0;
+
+        workers_.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++)
+        {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    /**
+     * @brief ^XNςށBL[ςȂ󂫂ł܂ő҂
+     * @param task s^XN
+     */
+    void Submit(std::function<void()> task)
+    {
+        if (workers_.empty())
+        {
+            task();
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (queue_.size() >= queue_depth_)
+            {
+                submit_stalls_++;
+                not_full_.wait(lock, [this] { return queue_.size() < queue_depth_; });
+            }
+            queue_.push_back(std::move(task));
+        }
+        not_empty_.notify_one();
+    }
+
+    /**
+     * @brief ς񂾃^XNׂďI܂ő҂
+     *
+     * ^XNO𓊂Ă΁Aŏ̗Oœ
+     */
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return queue_.empty() && running_ == 0; });
+
+        if (error_)
+        {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    /**
+     * @brief ς񂾃^XNsIĂ烏[J[I
+     */
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        not_empty_.notify_all();
+
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+        workers_.clear();
+    }
+
+    uint32_t ThreadCount() const
+    {
+        return static_cast<uint32_t>(workers_.size());
+    }
+
+    /**
+     * @brief ɕ^XN̍ő吔isƎs҂̍vj
+     */
+    uint32_t Capacity() const
+    {
+        return workers_.empty() ? 0 : ThreadCount() + queue_depth_;
+    }
+
+    uint32_t QueueDepth() const
+    {
+        return queue_depth_;
+    }
+
+    /**
+     * @brief L[ςSubmit҂ꂽ
+     */
+    uint64_t SubmitStalls() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return submit_stalls_;
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> queue_;
+    uint32_t queue_depth_ = 1;
+
+    // s̃^XN̐
+    uint32_t running_ = 0;
+
+    bool stopping_ = false;
+    uint64_t submit_stalls_ = 0;
+
+    // ^XNŏ̗O
+    std::exception_ptr error_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::condition_variable idle_;
+
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_empty_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+
+                if (queue_.empty())
+                {
+                    return;
+                }
+
+                task = std::move(queue_.front());
+                queue_.pop_front();
+                running_++;
+            }
+            not_full_.notify_one();
+
+            std::exception_ptr error;
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_--;
+                if (error && !error_)
+                {
+                    error_ = error;
+                }
+            }
+            idle_.notify_all();
+        }
+    }
+};
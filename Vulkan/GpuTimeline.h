@@ -0,0 +1,248 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <cstdint>
+
+/**
+ * @brief 1̃L[ւ̑MɁAPɑlUĊǐՂ
+ *
+ * Submit邽тɒl1i߁ȂMƃ^CC̒lɒBB
+ * ^CCZ}tHg΂ɒlVOiAgȂΑMƂɃtFX蓖ĂđɂB
+ * Wait͎w肵l̑M҂iL[Ŝ͑҂ȂjAIsComplete͑҂Ɋ𒲂ׂB
+ * SubmitAWait͕`惋[ṽXbhAIsCompleteCompletedValue͂ǂ̃XbhĂł悢
+ */
+class GpuTimeline
+{
+public:
+    GpuTimeline() = default;
+
+    GpuTimeline(const GpuTimeline&) = delete;
+    GpuTimeline& operator=(const GpuTimeline&) = delete;
+
+    /**
+     * @brief foCX^CCZ}tHg邩iVulkan 1.2̃RA@\Ƃāj
+     */
+    static bool IsSupported(const vk::PhysicalDevice physical_device)
+    {
+        if (physical_device.getProperties().apiVersion < VK_API_VERSION_1_2)
+        {
+            return false;
+        }
+
+        const auto features = physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+        return features.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>().timelineSemaphore == VK_TRUE;
+    }
+
+    /**
+     * @param device _foCXi^CCZ}tHgȂA̋@\Lɂč쐬́j
+     * @param queue M̃L[
+     * @param use_timeline_semaphore ^CCZ}tHgifalseȂtFXgj
+     */
+    void Init(const vk::Device device, const vk::Queue queue, const bool use_timeline_semaphore)
+    {
+        device_ = device;
+        queue_ = queue;
+        use_timeline_semaphore_ = use_timeline_semaphore;
+        submitted_value_ = 0;
+        completed_value_ = 0;
+
+        if (use_timeline_semaphore_)
+        {
+            vk::SemaphoreTypeCreateInfo semaphore_type_create_info(vk::SemaphoreType::eTimeline, 0);
+            vk::SemaphoreCreateInfo semaphore_create_info;
+            semaphore_create_info.pNext = &semaphore_type_create_info;
+            semaphore_ = device_.createSemaphoreUnique(semaphore_create_info);
+        }
+    }
+
+    bool UsesTimelineSemaphore() const
+    {
+        return use_timeline_semaphore_;
+    }
+
+    /**
+     * @brief submit_infoL[֑MÅ\lԂ
+     *
+     * ^CCZ}tH̃VOisubmit_infõVOǐɉ
+     * @param submit_info Me
+     * @return MɐUliO1傫j
+     */
+    uint64_t Submit(const vk::SubmitInfo& submit_info)
+    {
+        const uint64_t value = submitted_value_ + 1;
+
+        if (use_timeline_semaphore_)
+        {
+            // ̃VOiioCiZ}tHjɒl͗vȂA͑Kv
+            std::vector<vk::Semaphore> signal_semaphores(submit_info.pSignalSemaphores, submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+            std::vector<uint64_t> signal_values(signal_semaphores.size(), 0);
+            signal_semaphores.push_back(semaphore_.get());
+            signal_values.push_back(value);
+
+            vk::TimelineSemaphoreSubmitInfo timeline_submit_info;
+            timeline_submit_info.signalSemaphoreValueCount = static_cast<uint32_t>(signal_values.size());
+            timeline_submit_info.pSignalSemaphoreValues = signal_values.data();
+
+            vk::SubmitInfo timeline_submit = submit_info;
+            timeline_submit.pNext = &timeline_submit_info;
+            timeline_submit.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+            timeline_submit.pSignalSemaphores = signal_semaphores.data();
+
+            queue_.submit({ timeline_submit }, nullptr);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(fences_mutex_);
+
+            vk::UniqueFence fence;
+            if (free_fences_.empty())
+            {
+                fence = device_.createFenceUnique(vk::FenceCreateInfo());
+            }
+            else
+            {
+                fence = std::move(free_fences_.back());
+                free_fences_.pop_back();
+            }
+
+            queue_.submit({ submit_info }, fence.get());
+            pending_fences_.push_back({ value, std::move(fence) });
+        }
+
+        submitted_value_ = value;
+        return value;
+    }
+
+    /**
+     * @brief lvaluȇM܂ő҂ȋM͑҂Ȃj
+     */
+    void Wait(const uint64_t value)
+    {
+        if (completed_value_.load() >= value)
+        {
+            return;
+        }
+
+        if (use_timeline_semaphore_)
+        {
+            const vk::Semaphore semaphore = semaphore_.get();
+            vk::SemaphoreWaitInfo wait_info;
+            wait_info.semaphoreCount = 1;
+            wait_info.pSemaphores = &semaphore;
+            wait_info.pValues = &value;
+            if (device_.waitSemaphores(wait_info, UINT64_MAX) != vk::Result::eSuccess)
+            {
+                throw std::runtime_error("Failed to wait for timeline semaphore!");
+            }
+            AdvanceCompletedValue(value);
+            return;
+        }
+
+        // MɃtFX҂AvalueɒBƂł߂
+        std::lock_guard<std::mutex> lock(fences_mutex_);
+        while (!pending_fences_.empty() && pending_fences_.front().value <= value)
+        {
+            if (device_.waitForFences(pending_fences_.front().fence.get(), VK_TRUE, UINT64_MAX) != vk::Result::eSuccess)
+            {
+                throw std::runtime_error("Failed to wait for frame fence!");
+            }
+            RetireFrontFence();
+        }
+    }
+
+    /**
+     * @brief lvaluȇMĂ邩A҂ɒׂ
+     *
+     * tFXgꍇAʂ̃XbhtFX𒲂ׂĂŒȂA܂łɕĂ錋ʂœ
+     */
+    bool IsComplete(const uint64_t value)
+    {
+        if (completed_value_.load() >= value)
+        {
+            return true;
+        }
+
+        if (use_timeline_semaphore_)
+        {
+            AdvanceCompletedValue(device_.getSemaphoreCounterValue(semaphore_.get()));
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(fences_mutex_, std::try_to_lock);
+            if (lock.owns_lock())
+            {
+                while (!pending_fences_.empty() && device_.getFenceStatus(pending_fences_.front().fence.get()) == vk::Result::eSuccess)
+                {
+                    RetireFrontFence();
+                }
+            }
+        }
+
+        return completed_value_.load() >= value;
+    }
+
+    /**
+     * @brief Ăő̒liIsCompleteWaitōXVj
+     */
+    uint64_t CompletedValue() const
+    {
+        return completed_value_.load();
+    }
+
+    /**
+     * @brief ŌɑMl
+     */
+    uint64_t SubmittedValue() const
+    {
+        return submitted_value_;
+    }
+
+private:
+    struct PendingFence
+    {
+        uint64_t value;
+        vk::UniqueFence fence;
+    };
+
+    vk::Device device_;
+    vk::Queue queue_;
+    bool use_timeline_semaphore_ = false;
+
+    vk::UniqueSemaphore semaphore_;
+
+    // ŌɑMliMXbhǂݏj
+    uint64_t submitted_value_ = 0;
+
+    // Ăő̒l
+    std::atomic<uint64_t> completed_value_{ 0 };
+
+    // tFXgꍇ́AMɕׂ҂̃tFXƁAZbgς݂ōėpłtFX
+    std::mutex fences_mutex_;
+    std::deque<PendingFence> pending_fences_;
+    std::vector<vk::UniqueFence> free_fences_;
+
+    void AdvanceCompletedValue(const uint64_t value)
+    {
+        uint64_t completed = completed_value_.load();
+        while (completed < value && !completed_value_.compare_exchange_weak(completed, value))
+        {
+        }
+    }
+
+    /**
+     * @brief 擪̃tFXZbgčėpɉ񂷁ifences_mutex_ێČĂԁj
+     */
+    void RetireFrontFence()
+    {
+        PendingFence& front = pending_fences_.front();
+        device_.resetFences(front.fence.get());
+        AdvanceCompletedValue(front.value);
+        free_fences_.push_back(std::move(front.fence));
+        pending_fences_.pop_front();
+    }
+};
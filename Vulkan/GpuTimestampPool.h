@@ -0,0 +1,180 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+
+/**
+ * @brief ^CX^vNGŃ_[pXƃRs[GPUԂv
+ *
+ * t[̃XbgƂɁA܂ʒuiQueryj̃NGkMaxTimestampsB
+ * t[MR}hobt@̐擪BeginĂŃNGZbgAԂ̋ڂWriteł̈ʒuɏB
+ * ǂ̈ʒu͋L^ƂɐAǂނƂɃNG̉pŒׂ̂ŁA
+ * ʁXɋL^Ďg񂷃R}hobt@XbgɏĂ悢B
+ * M̊҂AReadŋԂ̎Ԃo
+ */
+class GpuTimestampPool
+{
+public:
+    /**
+     * @brief Xbg̒̃NG̈ʒu
+     */
+    enum Query : uint32_t
+    {
+        // _[pX̑Oƌ
+        kRenderBegin = 0,
+        kRenderEnd = 1,
+
+        // Rs[̑Oiʂ̃L[ŃRs[ƂBȂkRenderEnd𑪂jƌ
+        kCopyBegin = 2,
+        kCopyEnd = 3,
+    };
+
+    // 1Xbg̃^CX^v̐
+    static constexpr uint32_t kMaxTimestamps = 4;
+
+    /**
+     * @brief 1t[̌vʁivłȂԂ͕j
+     */
+    struct Durations
+    {
+        double render_ms = -1.0;
+        double copy_ms = -1.0;
+    };
+
+    /**
+     * @brief NGv[쐬
+     * @param physical_device foCX
+     * @param device _foCX
+     * @param queue_family_index _[pXL^R}hobt@𑗐ML[t@~
+     * @param copy_queue_family_index kCopyBeginkCopyEndR}hobt@𑗐ML[t@~iL[ŃRs[Ȃqueue_family_indexj
+     * @param slot_count Xbg̐iGPU֓t[j
+     * @return ^CX^vg邩iL[t@~ΉĂȂfalseŁAȍ~̌Ăяo͉Ȃj
+     */
+    bool Create(const vk::PhysicalDevice physical_device, const vk::Device device, const uint32_t queue_family_index, const uint32_t copy_queue_family_index, const uint32_t slot_count)
+    {
+        const std::vector<vk::QueueFamilyProperties> families = physical_device.getQueueFamilyProperties();
+        const uint32_t valid_bits = families[queue_family_index].timestampValidBits;
+        if (valid_bits == 0)
+        {
+            return false;
+        }
+
+        device_ = device;
+        period_ns_ = physical_device.getProperties().limits.timestampPeriod;
+
+        // Lȃrbg̓t@~ƂɈႤƂ̂ŁAԂt@~̂̂Ő܂Ԃ𗎂Ƃ
+        // iRs[̃t@~ΉĂȂ΁ARs[̑O͏Ȃj
+        render_valid_mask_ = GetValidMask(valid_bits);
+        copy_valid_mask_ = GetValidMask(families[copy_queue_family_index].timestampValidBits);
+
+        query_pool_ = device.createQueryPoolUnique(vk::QueryPoolCreateInfo({}, vk::QueryType::eTimestamp, slot_count * kMaxTimestamps));
+        return true;
+    }
+
+    bool IsEnabled() const
+    {
+        return static_cast<bool>(query_pool_);
+    }
+
+    /**
+     * @brief XbĝׂẴNGZbgBt[ŏɑMR}hobt@ŁA_[pX̊OAWriteOɋL^邱
+     * @param cmd_buf L^̃R}hobt@
+     * @param slot Xbg
+     */
+    void Begin(const vk::CommandBuffer cmd_buf, const uint32_t slot)
+    {
+        if (!query_pool_)
+        {
+            return;
+        }
+
+        cmd_buf.resetQueryPool(query_pool_.get(), slot * kMaxTimestamps, kMaxTimestamps);
+    }
+
+    /**
+     * @brief sR}hstageɒBAXbgquerÿʒuɏ
+     * @param cmd_buf L^̃R}hobt@
+     * @param slot Xbg
+     * @param query ʒu
+     * @param stage ҂pCvCXe[W
+     */
+    void Write(const vk::CommandBuffer cmd_buf, const uint32_t slot, const Query query, const vk::PipelineStageFlagBits stage)
+    {
+        if (!query_pool_)
+        {
+            return;
+        }
+
+        cmd_buf.writeTimestamp(stage, query_pool_.get(), slot * kMaxTimestamps + query);
+    }
+
+    /**
+     * @brief _[pXƃRs[̎ԂԂBM̊҂ĂĂԂ
+     *
+     * ̃t[ŏȂʒu̓Zbgꂽ܂܁igpsjȂ̂ŁA̋Ԃ͌vłȂ̂Ƃ
+     * @param slot Xbg
+     */
+    Durations Read(const uint32_t slot) const
+    {
+        Durations durations;
+        if (!query_pool_)
+        {
+            return durations;
+        }
+
+        // ʒuƂɎƉp̑g󂯎iĂȂʒueNotReadyɂȂ邪Aꂽʒu̒l͓j
+        uint64_t results[kMaxTimestamps][2] = {};
+        const vk::Result result = device_.getQueryPoolResults(
+            query_pool_.get(), slot * kMaxTimestamps, kMaxTimestamps,
+            sizeof(results), results, sizeof(results[0]),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+
+        if (result != vk::Result::eSuccess && result != vk::Result::eNotReady)
+        {
+            return durations;
+        }
+
+        const auto available = [&](const Query query) { return results[query][1] != 0; };
+        const auto elapsed_ms = [&](const Query begin, const Query end, const uint64_t valid_mask)
+        {
+            // Lȃrbg𒴂ʃrbg͕sȂ̂ŗƂĂ獷
+            const uint64_t ticks = (results[end][0] - results[begin][0]) & valid_mask;
+            return ticks * double(period_ns_) / 1e6;
+        };
+
+        if (available(kRenderBegin) && available(kRenderEnd))
+        {
+            durations.render_ms = elapsed_ms(kRenderBegin, kRenderEnd, render_valid_mask_);
+        }
+
+        if (available(kCopyEnd))
+        {
+            if (available(kCopyBegin))
+            {
+                durations.copy_ms = elapsed_ms(kCopyBegin, kCopyEnd, copy_valid_mask_);
+            }
+            else if (available(kRenderEnd))
+            {
+                // kCopyBeginȂ͓̂L[ŃRs[ꍇŁAǂ_[pX̃t@~ŏĂ
+                durations.copy_ms = elapsed_ms(kRenderEnd, kCopyEnd, render_valid_mask_);
+            }
+        }
+        return durations;
+    }
+
+private:
+    vk::Device device_;
+    vk::UniqueQueryPool query_pool_;
+
+    // 1eBbÑimb
+    float period_ns_ = 1.0f;
+
+    // _[pX̑OiƂɑL[ł̃Rs[jƁARs[̑Õ^CX^v̗Lȃrbg
+    uint64_t render_valid_mask_ = ~uint64_t(0);
+    uint64_t copy_valid_mask_ = ~uint64_t(0);
+
+    static uint64_t GetValidMask(const uint32_t valid_bits)
+    {
+        return valid_bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << valid_bits) - 1;
+    }
+};
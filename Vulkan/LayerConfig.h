@@ -0,0 +1,217 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+/**
+ * @brief Lɂof[V̎
+ */
+enum class ValidationMode
+{
+    // C[LɂȂ
+    None,
+
+    // VK_LAYER_KHRONOS_validation
+    Standard,
+
+    // VK_LAYER_KHRONOS_validationɉāAVK_EXT_validation_featuresGPUxof[VLɂ
+    GpuAssisted,
+};
+
+/**
+ * @brief CX^XƃfoCXɗLɂ郌C[Ɗg߂
+ *
+ * vꂽ[hɕKvȃC[gCXg[ĂȂ΁A
+ * x\Ďg郂[h܂1iƂiC[ȂĂNł悤ɂj
+ */
+class LayerConfig
+{
+public:
+    static constexpr const char* kValidationLayerName = "VK_LAYER_KHRONOS_validation";
+
+    // [hw肷ϐinone, standard, gpuj
+    static constexpr const char* kEnvironmentVariable = "VULKAN_DRAW_TRIANGLE_VALIDATION";
+
+    LayerConfig() = default;
+
+    // validation_features_g̃oŵŃRs[Ȃ
+    LayerConfig(const LayerConfig&) = delete;
+    LayerConfig& operator=(const LayerConfig&) = delete;
+
+    /**
+     * @brief [h̖O߂
+     * @param name none, standard, gpûꂩ
+     * @param mode ߂[h
+     * @return ߂ł
+     */
+    static bool ParseMode(const std::string& name, ValidationMode& mode)
+    {
+        if (name == "none")
+        {
+            mode = ValidationMode::None;
+        }
+        else if (name == "standard")
+        {
+            mode = ValidationMode::Standard;
+        }
+        else if (name == "gpu")
+        {
+            mode = ValidationMode::GpuAssisted;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    static const char* ToString(const ValidationMode mode)
+    {
+        switch (mode)
+        {
+        case ValidationMode::Standard:
+            return "standard";
+        case ValidationMode::GpuAssisted:
+            return "gpu";
+        default:
+            return "none";
+        }
+    }
+
+    /**
+     * @brief ̃[hԂ
+     *
+     * ϐݒ肳Ă΂̒lAȂDebugrhłStandardAReleaserhłNone
+     */
+    static ValidationMode DefaultMode()
+    {
+        ValidationMode mode;
+        const char* value = std::getenv(kEnvironmentVariable);
+        if (value && ParseMode(value, mode))
+        {
+            return mode;
+        }
+
+        if (value)
+        {
+            std::cerr << kEnvironmentVariable << "=" << value << " is not none, standard or gpu (ignored)" << std::endl;
+        }
+
+#ifdef NDEBUG
+        return ValidationMode::None;
+#else
+        return ValidationMode::Standard;
+#endif
+    }
+
+    /**
+     * @brief [hɕKvȃC[ƊgCXg[Ă邩
+     */
+    static bool IsAvailable(const ValidationMode mode)
+    {
+        switch (mode)
+        {
+        case ValidationMode::Standard:
+            return HasInstanceLayer(kValidationLayerName);
+        case ValidationMode::GpuAssisted:
+            return HasInstanceLayer(kValidationLayerName) && HasLayerExtension(kValidationLayerName, VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+        default:
+            return true;
+        }
+    }
+
+    /**
+     * @brief vꂽ[hAۂɗLɂ郌C[Ɗg߂
+     * @param requested v郂[h
+     */
+    void Configure(const ValidationMode requested)
+    {
+        mode_ = requested;
+        while (!IsAvailable(mode_))
+        {
+            const ValidationMode fallback = mode_ == ValidationMode::GpuAssisted ? ValidationMode::Standard : ValidationMode::None;
+            std::cerr << "validation: " << ToString(mode_) << " is not available, falling back to " << ToString(fallback) << std::endl;
+            mode_ = fallback;
+        }
+
+        layers_.clear();
+        instance_extensions_.clear();
+
+        if (mode_ != ValidationMode::None)
+        {
+            layers_.push_back(kValidationLayerName);
+        }
+
+        if (mode_ == ValidationMode::GpuAssisted)
+        {
+            instance_extensions_.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+
+            enabled_features_[0] = vk::ValidationFeatureEnableEXT::eGpuAssisted;
+            enabled_features_[1] = vk::ValidationFeatureEnableEXT::eGpuAssistedReserveBindingSlot;
+            validation_features_.enabledValidationFeatureCount = 2;
+            validation_features_.pEnabledValidationFeatures = enabled_features_;
+        }
+
+        std::cout << "validation: " << ToString(mode_) << std::endl;
+    }
+
+    ValidationMode Mode() const
+    {
+        return mode_;
+    }
+
+    const std::vector<const char*>& Layers() const
+    {
+        return layers_;
+    }
+
+    const std::vector<const char*>& InstanceExtensions() const
+    {
+        return instance_extensions_;
+    }
+
+    /**
+     * @brief vk::InstanceCreateInfo::pNextɌq\́iGPUxof[V̂Ƃj
+     */
+    const void* InstanceCreateInfoNext() const
+    {
+        return mode_ == ValidationMode::GpuAssisted ? &validation_features_ : nullptr;
+    }
+
+private:
+    ValidationMode mode_ = ValidationMode::None;
+
+    std::vector<const char*> layers_;
+    std::vector<const char*> instance_extensions_;
+
+    vk::ValidationFeatureEnableEXT enabled_features_[2] = {};
+    vk::ValidationFeaturesEXT validation_features_;
+
+    static bool HasInstanceLayer(const char* name)
+    {
+        for (const vk::LayerProperties& layer : vk::enumerateInstanceLayerProperties())
+        {
+            if (std::strcmp(layer.layerName.data(), name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool HasLayerExtension(const char* layer_name, const char* extension_name)
+    {
+        for (const vk::ExtensionProperties& extension : vk::enumerateInstanceExtensionProperties(std::string(layer_name)))
+        {
+            if (std::strcmp(extension.extensionName.data(), extension_name) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+};
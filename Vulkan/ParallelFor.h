@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+/**
+ * @brief CfbNX͈̔͂𕡐̃XbhŕSď
+ *
+ * stbi_write_set_parallel_forɓn`iInvokejŁAdeflatẽ`NȂǂɏB
+ * ĂяoXbhɉBʂ̃XbhRunsŎgȂƂ́A
+ * ҂ɌĂяoXbhŏiGR[h̃[J[ɌĂłl܂Ȃj
+ */
+class ParallelFor
+{
+public:
+    // ^XN̊֐istbi_write_parallel_for_functaskƓ`j
+    using TaskFunc = void (*)(void* task_context, int index);
+
+    ParallelFor() = default;
+
+    ParallelFor(const ParallelFor&) = delete;
+    ParallelFor& operator=(const ParallelFor&) = delete;
+
+    ~ParallelFor()
+    {
+        Stop();
+    }
+
+    /**
+     * @brief [J[XbhN
+     * @param thread_count ĂяoXbh܂߂Xbhi1ȉȂ烏[J[Ȃj
+     */
+    void Start(const uint32_t thread_count)
+    {
+        Stop();
+
+        stopping_ = false;
+        for (uint32_t i = 1; i < thread_count; i++)
+        {
+            workers_.emplace_back([this] { WorkerLoop(); });
+        }
+    }
+
+    /**
+     * @brief task(task_context, index)[0, count)ׂ̂ĂindexɂĎsAI܂ő҂
+     */
+    void Run(const int count, const TaskFunc task, void* task_context)
+    {
+        std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+        if (!run_lock.owns_lock() || workers_.empty() || count <= 1)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                task(task_context, i);
+            }
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_ = task;
+        task_context_ = task_context;
+        next_ = 0;
+        count_ = count;
+        pending_ = count;
+        wake_.notify_all();
+
+        RunTasks(lock);
+        done_.wait(lock, [this] { return pending_ == 0; });
+    }
+
+    /**
+     * @brief stbi_write_set_parallel_forɓn֐BcontextɂParallelForn
+     */
+    static void Invoke(void* context, const int count, const TaskFunc task, void* task_context)
+    {
+        static_cast<ParallelFor*>(context)->Run(count, task, task_context);
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+
+        for (std::thread& worker : workers_)
+        {
+            worker.join();
+        }
+        workers_.clear();
+    }
+
+    /**
+     * @brief ĂяoXbh܂߂Xbh
+     */
+    uint32_t ThreadCount() const
+    {
+        return static_cast<uint32_t>(workers_.size()) + 1;
+    }
+
+private:
+    std::vector<std::thread> workers_;
+
+    // Run𓯎1ɂ
+    std::mutex run_mutex_;
+
+    // ȉmutex_ŕی삷BCfbNX̓bN1oi^XN͑êŏ\j
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    TaskFunc task_ = nullptr;
+    void* task_context_ = nullptr;
+    int next_ = 0;
+    int count_ = 0;
+    int pending_ = 0;
+    bool stopping_ = false;
+
+    /**
+     * @brief cĂCfbNXoĎsBlock͕ێԂŌĂсAێԂŖ߂
+     */
+    void RunTasks(std::unique_lock<std::mutex>& lock)
+    {
+        while (next_ < count_)
+        {
+            const int index = next_++;
+            const TaskFunc task = task_;
+            void* const task_context = task_context_;
+
+            lock.unlock();
+            task(task_context, index);
+            lock.lock();
+
+            if (--pending_ == 0)
+            {
+                done_.notify_all();
+            }
+        }
+    }
+
+    void WorkerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;)
+        {
+            wake_.wait(lock, [this] { return stopping_ || next_ < count_; });
+            if (next_ >= count_)
+            {
+                return;
+            }
+            RunTasks(lock);
+        }
+    }
+};
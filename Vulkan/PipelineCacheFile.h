@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <iostream>
+
+/**
+ * @brief fBXNɕۑVkPipelineCache
+ *
+ * NɃt@Cǂݍ񂾃f[^ŃpCvCLbV쐬AIɏ߂B
+ * LbV͍쐬foCXƃhCołgȂ̂ŁA
+ * Ǝ̃wb_ɃfoCXpipelineCacheUUIDƃhCõo[WL^AvȂΓǂݎ̂ĂB
+ */
+class PipelineCacheFile
+{
+public:
+    explicit PipelineCacheFile(std::string path) : path_(std::move(path))
+    {
+    }
+
+    /**
+     * @brief t@CǂݍŃpCvCLbV쐬
+     *
+     * t@CȂA܂͕ʂ̃foCXhCoōꂽ̂ł΋̃LbV쐬
+     * @param physical_device foCX
+     * @param device _foCX
+     * @return pCvCLbV
+     */
+    vk::UniquePipelineCache Load(const vk::PhysicalDevice physical_device, const vk::Device device)
+    {
+        properties_ = physical_device.getProperties();
+
+        const std::vector<uint8_t> initial_data = ReadValidatedData();
+        warm_ = !initial_data.empty();
+
+        vk::PipelineCacheCreateInfo pipeline_cache_create_info;
+        pipeline_cache_create_info.initialDataSize = initial_data.size();
+        pipeline_cache_create_info.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+
+        return device.createPipelineCacheUnique(pipeline_cache_create_info);
+    }
+
+    /**
+     * @brief pCvCLbVt@Cɏo
+     *
+     * ꎞt@CɏĂûŁArŒfĂꂽt@C͎cȂ
+     * @param device _foCX
+     * @param pipeline_cache opCvCLbV
+     */
+    void Save(const vk::Device device, const vk::PipelineCache pipeline_cache) const
+    {
+        const std::vector<uint8_t> data = device.getPipelineCacheData(pipeline_cache);
+
+        const Header header = MakeHeader(data);
+        const std::string temp_path = path_ + ".tmp";
+
+        {
+            std::ofstream file(temp_path, std::ios_base::binary | std::ios_base::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+            if (!file)
+            {
+                std::cerr << "pipeline cache: failed to write " << temp_path << std::endl;
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temp_path, path_, error);
+        if (error)
+        {
+            std::cerr << "pipeline cache: failed to replace " << path_ << ": " << error.message() << std::endl;
+            std::filesystem::remove(temp_path, error);
+            return;
+        }
+
+        std::cout << "pipeline cache: saved " << data.size() << " bytes to " << path_ << std::endl;
+    }
+
+    /**
+     * @brief LȃLbVǂݍ߂iEH[X^[gj
+     */
+    bool IsWarm() const
+    {
+        return warm_;
+    }
+
+private:
+    /**
+     * @brief t@C̐擪ɒuƎ̃wb_
+     */
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+        uint64_t data_hash;
+    };
+
+    static constexpr uint32_t kMagic = 0x43504B56; // "VKPC"
+    static constexpr uint32_t kVersion = 1;
+
+    std::string path_;
+    vk::PhysicalDeviceProperties properties_;
+    bool warm_ = false;
+
+    /**
+     * @brief f[^̃nbViFNV-1ajBt@C̔jr܂łĂȂ̂o
+     */
+    static uint64_t Hash(const std::vector<uint8_t>& data)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const uint8_t byte : data)
+        {
+            hash = (hash ^ byte) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    Header MakeHeader(const std::vector<uint8_t>& data) const
+    {
+        Header header = {};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.vendor_id = properties_.vendorID;
+        header.device_id = properties_.deviceID;
+        header.driver_version = properties_.driverVersion;
+        std::memcpy(header.pipeline_cache_uuid, properties_.pipelineCacheUUID.data(), VK_UUID_SIZE);
+        header.data_size = data.size();
+        header.data_hash = Hash(data);
+        return header;
+    }
+
+    /**
+     * @brief t@Cǂݍ݁ÃfoCXƃhCoōꂽ̂ł΃LbṼf[^Ԃ
+     * @return LbṼf[^igȂꍇ͋j
+     */
+    std::vector<uint8_t> ReadValidatedData() const
+    {
+        std::ifstream file(path_, std::ios_base::binary);
+        if (!file)
+        {
+            std::cout << "pipeline cache: " << path_ << " not found (cold start)" << std::endl;
+            return {};
+        }
+
+        std::error_code error;
+        const uintmax_t file_size = std::filesystem::file_size(path_, error);
+
+        Header header = {};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        const Header expected = MakeHeader({});
+        const bool same_device =
+            file &&
+            header.magic == expected.magic &&
+            header.version == expected.version &&
+            header.vendor_id == expected.vendor_id &&
+            header.device_id == expected.device_id &&
+            header.driver_version == expected.driver_version &&
+            std::memcmp(header.pipeline_cache_uuid, expected.pipeline_cache_uuid, VK_UUID_SIZE) == 0;
+
+        if (!same_device)
+        {
+            std::cout << "pipeline cache: " << path_ << " was created by another device or driver (cold start)" << std::endl;
+            return {};
+        }
+
+        if (error || file_size != sizeof(header) + header.data_size)
+        {
+            std::cout << "pipeline cache: " << path_ << " is truncated (cold start)" << std::endl;
+            return {};
+        }
+
+        std::vector<uint8_t> data(static_cast<size_t>(header.data_size));
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!file || Hash(data) != header.data_hash)
+        {
+            std::cout << "pipeline cache: " << path_ << " is corrupted (cold start)" << std::endl;
+            return {};
+        }
+
+        std::cout << "pipeline cache: loaded " << data.size() << " bytes from " << path_ << " (warm start)" << std::endl;
+        return data;
+    }
+};
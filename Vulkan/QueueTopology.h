@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+/**
+ * @brief foCX̃L[t@~AprƂɎgt@~I
+ *
+ * OtBbNX̃t@~ɉāAOtBbNXȂ]p̃t@~iDMAGWj
+ * 񓯊Rs[g̃t@~TB]p̃t@~Ȃ΁A񓯊Rs[g̃t@~
+ * ]ɎgiRs[gt@~͓]łj
+ */
+class QueueTopology
+{
+public:
+    // Ȃt@~̃CfbNX
+    static constexpr uint32_t kNoFamily = UINT32_MAX;
+
+    /**
+     * @brief foCX̃L[t@~𒲂ׂāAgt@~I
+     * @param physical_device foCX
+     * @return OtBbNX̃t@~邩iȂ΂̃foCX͎gȂj
+     */
+    bool Select(const vk::PhysicalDevice physical_device)
+    {
+        families_ = physical_device.getQueueFamilyProperties();
+        graphics_family_ = kNoFamily;
+        transfer_family_ = kNoFamily;
+        compute_family_ = kNoFamily;
+
+        uint32_t transfer_only_family = kNoFamily;
+        for (uint32_t i = 0; i < families_.size(); i++)
+        {
+            const vk::QueueFlags flags = families_[i].queueFlags;
+            if (families_[i].queueCount == 0)
+            {
+                continue;
+            }
+
+            if (flags & vk::QueueFlagBits::eGraphics)
+            {
+                if (graphics_family_ == kNoFamily)
+                {
+                    graphics_family_ = i;
+                }
+            }
+            else if (flags & vk::QueueFlagBits::eCompute)
+            {
+                if (compute_family_ == kNoFamily)
+                {
+                    compute_family_ = i;
+                }
+            }
+            else if (flags & vk::QueueFlagBits::eTransfer)
+            {
+                if (transfer_only_family == kNoFamily)
+                {
+                    transfer_only_family = i;
+                }
+            }
+        }
+
+        transfer_family_ = transfer_only_family != kNoFamily ? transfer_only_family : compute_family_;
+        return graphics_family_ != kNoFamily;
+    }
+
+    uint32_t GraphicsFamily() const
+    {
+        return graphics_family_;
+    }
+
+    /**
+     * @brief ǂݏõRs[ɎgAOtBbNXƂ͕ʂ̃t@~iȂkNoFamilyj
+     */
+    uint32_t TransferFamily() const
+    {
+        return transfer_family_;
+    }
+
+    /**
+     * @brief OtBbNXȂRs[g̃t@~iȂkNoFamilyj
+     */
+    uint32_t ComputeFamily() const
+    {
+        return compute_family_;
+    }
+
+    bool HasTransferFamily() const
+    {
+        return transfer_family_ != kNoFamily;
+    }
+
+    /**
+     * @brief ]̃t@~Ń^CX^v邩
+     */
+    bool TransferSupportsTimestamps() const
+    {
+        return HasTransferFamily() && families_[transfer_family_].timestampValidBits > 0;
+    }
+
+    /**
+     * @brief _foCXɍL[igt@~Ƃ1j
+     * @param use_transfer ]̃t@~̃L[邩
+     */
+    std::vector<vk::DeviceQueueCreateInfo> QueueCreateInfos(const bool use_transfer) const
+    {
+        static const float queue_priorities[1] = { 1.0f };
+
+        std::vector<vk::DeviceQueueCreateInfo> queue_create_infos(use_transfer && HasTransferFamily() ? 2 : 1);
+        for (vk::DeviceQueueCreateInfo& queue_create_info : queue_create_infos)
+        {
+            queue_create_info.queueCount = 1;
+            queue_create_info.pQueuePriorities = queue_priorities;
+        }
+        queue_create_infos[0].queueFamilyIndex = graphics_family_;
+        if (queue_create_infos.size() > 1)
+        {
+            queue_create_infos[1].queueFamilyIndex = transfer_family_;
+        }
+        return queue_create_infos;
+    }
+
+    /**
+     * @brief I񂾃t@~\
+     */
+    void Print() const
+    {
+        std::cout << "queue families: graphics " << graphics_family_;
+        if (transfer_family_ == kNoFamily)
+        {
+            std::cout << ", transfer none";
+        }
+        else
+        {
+            std::cout << ", transfer " << transfer_family_ << (transfer_family_ == compute_family_ ? " (async compute)" : " (dedicated)");
+        }
+        if (compute_family_ == kNoFamily)
+        {
+            std::cout << ", async compute none";
+        }
+        else
+        {
+            std::cout << ", async compute " << compute_family_;
+        }
+        std::cout << std::endl;
+    }
+
+private:
+    std::vector<vk::QueueFamilyProperties> families_;
+
+    uint32_t graphics_family_ = kNoFamily;
+    uint32_t transfer_family_ = kNoFamily;
+    uint32_t compute_family_ = kNoFamily;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+
+#include "DeviceMemoryAllocator.h"
+
+/**
+ * @brief iIɃ}bvǂݏopobt@̃v[
+ *
+ * t[ƂAcquireŃobt@̏L󂯎A
+ * oIReleaseŃv[֕ԂB
+ * obt@͍쐬Ɉx}bvAȍ~̓}bvEA}bvmۂsȂB
+ */
+class ReadbackBufferPool
+{
+public:
+    /**
+     * @brief v[Lǂݏopobt@
+     */
+    struct Entry
+    {
+        vk::UniqueBuffer buffer;
+        DeviceMemoryAllocator::Allocation allocation;
+
+        // obt@̃TCY
+        vk::DeviceSize size = 0;
+
+        // iIɃ}bvAhX
+        const void* mapped = nullptr;
+    };
+
+    /**
+     * @brief ǂݏopobt@count쐬ă}bv
+     * @param device _foCX
+     * @param allocator obt@̃؂oAP[^iv[蒷邱Ɓj
+     * @param count obt@̐
+     * @param size obt@1̃TCY
+     * @param memory_type_index obt@Ɋ蓖Ă郁^CviHostVisibleł邱Ɓj
+     */
+    void Create(const vk::Device device, DeviceMemoryAllocator& allocator, const uint32_t count, const vk::DeviceSize size, const uint32_t memory_type_index)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // ȑOɍ쐬obt@̃̓AP[^֕Ԃ
+        DestroyEntries();
+
+        allocator_ = &allocator;
+
+        entries_.resize(count);
+        free_indices_.reserve(count);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Entry& entry = entries_[i];
+
+            vk::BufferCreateInfo buffer_create_info;
+            buffer_create_info.size = size;
+            buffer_create_info.usage = vk::BufferUsageFlagBits::eTransferDst;
+
+            entry.buffer = device.createBufferUnique(buffer_create_info);
+
+            // AP[^̃ubN͍쐬Ƀ}bvς݂Ȃ̂ŁÃAhX̂܂܎g
+            entry.allocation = allocator.AllocateForBuffer(entry.buffer.get(), memory_type_index);
+            entry.mapped = entry.allocation.mapped;
+            entry.size = size;
+
+            free_indices_.push_back(i);
+        }
+    }
+
+    /**
+     * @brief ׂẴobt@jAAP[^֕Ԃ
+     *
+     * ؂Ăobt@ȂƂɌĂԂ
+     */
+    void Destroy()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        DestroyEntries();
+    }
+
+    /**
+     * @brief 󂢂Ăobt@̏L󂯎B󂫂ȂΕԋp܂ő҂
+     * @return obt@̃CfbNX
+     */
+    uint32_t Acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        available_.wait(lock, [this] { return !free_indices_.empty(); });
+
+        const uint32_t index = free_indices_.back();
+        free_indices_.pop_back();
+        return index;
+    }
+
+    /**
+     * @brief oIobt@v[֕Ԃ
+     * @param index AcquireŎ󂯎CfbNX
+     */
+    void Release(const uint32_t index)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_indices_.push_back(index);
+        }
+        available_.notify_one();
+    }
+
+    /**
+     * @brief GPU񂾓eCPUǂ߂悤ɂ
+     *
+     * HostCoherentłȂł́AM̊҂AǂޑOɌĂԕKv
+     * @param index AcquireŎ󂯎CfbNX
+     */
+    void Invalidate(const uint32_t index) const
+    {
+        allocator_->Invalidate(entries_[index].allocation);
+    }
+
+    const Entry& Get(const uint32_t index) const
+    {
+        return entries_[index];
+    }
+
+    uint32_t Size() const
+    {
+        return static_cast<uint32_t>(entries_.size());
+    }
+
+private:
+    DeviceMemoryAllocator* allocator_ = nullptr;
+
+    std::vector<Entry> entries_;
+
+    // 󂢂Ăobt@̃CfbNXieʂ͍쐬Ɋmۍς݁j
+    std::vector<uint32_t> free_indices_;
+
+    std::mutex mutex_;
+    std::condition_variable available_;
+
+    /**
+     * @brief obt@jăAP[^֕Ԃimutex_bNČĂԁj
+     */
+    void DestroyEntries()
+    {
+        for (Entry& entry : entries_)
+        {
+            entry.buffer.reset();
+            allocator_->Free(entry.allocation);
+        }
+
+        entries_.clear();
+        free_indices_.clear();
+    }
+};
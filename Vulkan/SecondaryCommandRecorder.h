@@ -0,0 +1,157 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <vector>
+#include <exception>
+#include <type_traits>
+#include <cstdint>
+
+#include "ParallelFor.h"
+
+/**
+ * @brief _[pX̒gAXCXɕZJ_R}hobt@֕̃XbhŋL^
+ *
+ * XCXƂɃR}hv[ƃZJ_R}hobt@1B
+ * 1̃XCX͓1̃XbhL^Ȃ̂ŁAv[̓XbhƂ̂̂ƂĊOȂɎgB
+ * L^Ƃ̓R}hobt@ʂɉAv[ƃZbgB
+ * L^R}hobt@̓vC}executeCommandsŎs
+ */
+class SecondaryCommandRecorder
+{
+public:
+    /**
+     * @param device _foCX
+     * @param queue_family_index vC}𑗐ML[̃t@~
+     * @param slice_count XCX̐iL^Xbh̐j
+     */
+    void Init(const vk::Device device, const uint32_t queue_family_index, const uint32_t slice_count)
+    {
+        // R}hobt@̓v[ɉ
+        cmd_bufs_.clear();
+        unique_cmd_bufs_.clear();
+        pools_.clear();
+        recorded_ = false;
+
+        device_ = device;
+
+        vk::CommandPoolCreateInfo cmd_pool_create_info;
+        cmd_pool_create_info.queueFamilyIndex = queue_family_index;
+
+        for (uint32_t i = 0; i < slice_count; i++)
+        {
+            pools_.push_back(device_.createCommandPoolUnique(cmd_pool_create_info));
+
+            vk::CommandBufferAllocateInfo cmd_buf_alloc_info;
+            cmd_buf_alloc_info.commandPool = pools_.back().get();
+            cmd_buf_alloc_info.commandBufferCount = 1;
+            cmd_buf_alloc_info.level = vk::CommandBufferLevel::eSecondary;
+            unique_cmd_bufs_.push_back(std::move(device_.allocateCommandBuffersUnique(cmd_buf_alloc_info).front()));
+            cmd_bufs_.push_back(unique_cmd_bufs_.back().get());
+        }
+    }
+
+    /**
+     * @brief v[ZbgāAitem_count̍ڂXCXɕċL^
+     *
+     * XCXirecord_slice(cmd_buf, first, count)[first, first + count)̍ڂL^ibeginend͂ōsj
+     * @param workers L^𕪒SXbh
+     * @param inheritance s郌_[pXATupXAt[obt@
+     * @param item_count ځih[R[j̐
+     * @param record_slice XCXL^֐B̃Xbh瓯ɌĂ΂
+     */
+    template <typename RecordSlice>
+    void Record(ParallelFor& workers, const vk::CommandBufferInheritanceInfo& inheritance, const uint32_t item_count, RecordSlice&& record_slice)
+    {
+        struct Context
+        {
+            SecondaryCommandRecorder* recorder;
+            const vk::CommandBufferInheritanceInfo* inheritance;
+            uint32_t item_count;
+            typename std::remove_reference<RecordSlice>::type* record_slice;
+
+            // XCXƂ̗Oi[J[̊O֓Ȃ̂ŁAœj
+            std::vector<std::exception_ptr> errors;
+        };
+
+        Context context = { this, &inheritance, item_count, &record_slice, std::vector<std::exception_ptr>(cmd_bufs_.size()) };
+        recorded_ = false;
+
+        workers.Run(static_cast<int>(cmd_bufs_.size()), [](void* task_context, const int index)
+        {
+            Context& context = *static_cast<Context*>(task_context);
+            try
+            {
+                context.recorder->RecordSliceAt(index, *context.inheritance, context.item_count, *context.record_slice);
+            }
+            catch (...)
+            {
+                context.errors[index] = std::current_exception();
+            }
+        }, &context);
+
+        for (const std::exception_ptr& error : context.errors)
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+        recorded_ = true;
+    }
+
+    /**
+     * @brief L^R}hobt@ARecord܂ŎgȂ
+     */
+    void Invalidate()
+    {
+        recorded_ = false;
+    }
+
+    bool Recorded() const
+    {
+        return recorded_;
+    }
+
+    uint32_t SliceCount() const
+    {
+        return static_cast<uint32_t>(cmd_bufs_.size());
+    }
+
+    /**
+     * @brief executeCommandsɓnR}hobt@iXCX̏j
+     */
+    const std::vector<vk::CommandBuffer>& CommandBuffers() const
+    {
+        return cmd_bufs_;
+    }
+
+private:
+    vk::Device device_;
+
+    // XCXƂ̃v[ƃR}hobt@iR}hobt@ɔj悤Av[ɐ錾j
+    std::vector<vk::UniqueCommandPool> pools_;
+    std::vector<vk::UniqueCommandBuffer> unique_cmd_bufs_;
+    std::vector<vk::CommandBuffer> cmd_bufs_;
+
+    bool recorded_ = false;
+
+    template <typename RecordSlice>
+    void RecordSliceAt(const int index, const vk::CommandBufferInheritanceInfo& inheritance, const uint32_t item_count, RecordSlice& record_slice)
+    {
+        const uint32_t slice_count = SliceCount();
+        const uint32_t first = static_cast<uint32_t>(uint64_t(item_count) * index / slice_count);
+        const uint32_t last = static_cast<uint32_t>(uint64_t(item_count) * (index + 1) / slice_count);
+
+        device_.resetCommandPool(pools_[index].get(), {});
+
+        // t[̃̕vC}iǂݏo悲ƁjŝeSimultaneousUset
+        vk::CommandBufferBeginInfo begin_info;
+        begin_info.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eSimultaneousUse;
+        begin_info.pInheritanceInfo = &inheritance;
+
+        const vk::CommandBuffer cmd_buf = cmd_bufs_[index];
+        cmd_buf.begin(begin_info);
+        record_slice(cmd_buf, first, last - first);
+        cmd_buf.end();
+    }
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+/**
+ * @brief CPȔԂL^AChromẽg[XCxg`ichrome://tracing, Perfettojŏo
+ *
+ * StartĂԂ܂ł͖ŁATRACE_SCOPẼRXg̓tO1ǂނB
+ * Ԃ̖O͕񃊃eȂǁAo܂Ő镶nƁiJSOÑGXP[v͂Ȃj
+ */
+class Tracer
+{
+public:
+    static Tracer& Get()
+    {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    /**
+     * @brief L^Jn
+     */
+    void Start()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.clear();
+        events_.reserve(4096);
+        epoch_ = std::chrono::steady_clock::now();
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    bool IsEnabled() const
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief ݎL^Jñ}CNbŕԂ
+     */
+    double Now() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch_).count();
+    }
+
+    /**
+     * @brief Ԃ1L^
+     * @param name Ԃ̖O
+     * @param begin_us JniNow̒lj
+     * @param end_us IiNow̒lj
+     * @param arg_name tl̖OinullptrȂtȂj
+     * @param arg_value tl
+     */
+    void Record(const char* name, const double begin_us, const double end_us, const char* arg_name, const int64_t arg_value)
+    {
+        const Event event = { name, begin_us, end_us - begin_us, ThreadIndex(), arg_name, arg_value };
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.push_back(event);
+    }
+
+    /**
+     * @brief L^IAL^Ԃt@Cɏo
+     * @param path ot@C
+     */
+    void StopAndWrite(const std::string& path)
+    {
+        enabled_.store(false, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::ofstream file(path, std::ios_base::trunc);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        char line[256];
+        for (size_t i = 0; i < events_.size(); i++)
+        {
+            const Event& event = events_[i];
+            file << (i == 0 ? "\n" : ",\n");
+
+            std::snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f",
+                event.name, event.thread_index, event.begin_us, event.duration_us);
+            file << line;
+
+            if (event.arg_name)
+            {
+                std::snprintf(line, sizeof(line), ",\"args\":{\"%s\":%lld}", event.arg_name, static_cast<long long>(event.arg_value));
+                file << line;
+            }
+            file << "}";
+        }
+        file << "\n]}\n";
+
+        if (!file)
+        {
+            std::cerr << "trace: failed to write " << path << std::endl;
+            return;
+        }
+
+        std::cout << "trace: wrote " << events_.size() << " events to " << path << std::endl;
+    }
+
+private:
+    /**
+     * @brief L^
+     */
+    struct Event
+    {
+        const char* name;
+        double begin_us;
+        double duration_us;
+        uint32_t thread_index;
+        const char* arg_name;
+        int64_t arg_value;
+    };
+
+    std::atomic<bool> enabled_{ false };
+    std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+
+    std::mutex mutex_;
+    std::vector<Event> events_;
+
+    /**
+     * @brief XbhƂ̒ʂԍig[Xr[A̍sɂȂj
+     */
+    static uint32_t ThreadIndex()
+    {
+        static std::atomic<uint32_t> next_index{ 0 };
+        thread_local const uint32_t index = next_index.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+};
+
+/**
+ * @brief XR[v̊JnI܂ł1̋ԂƂċL^
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, const char* arg_name = nullptr, const int64_t arg_value = 0)
+    {
+        Tracer& tracer = Tracer::Get();
+        if (tracer.IsEnabled())
+        {
+            name_ = name;
+            arg_name_ = arg_name;
+            arg_value_ = arg_value;
+            begin_us_ = tracer.Now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (name_)
+        {
+            Tracer& tracer = Tracer::Get();
+            tracer.Record(name_, begin_us_, tracer.Now(), arg_name_, arg_value_);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    // ȂƂnullptr̂܂܂ŁAfXgN^͉Ȃ
+    const char* name_ = nullptr;
+    const char* arg_name_ = nullptr;
+    int64_t arg_value_ = 0;
+    double begin_us_ = 0.0;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+// XR[v̏I܂łnameƂċL^BTRACE_SCOPE("Encode", "frame", index)̂悤ɒl1t
+#define TRACE_SCOPE(...) const TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(__VA_ARGS__)
@@ -1,512 +1,2471 @@
-#include <GLFW/glfw3.h>
-
-#define VK_USE_PLATFORM_WIN32_KHR
-#define GLFW_INCLUDE_VULKAN
-
 #include <vulkan/vulkan.hpp>
-#include <glm/glm.hpp>
 #include <vector>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
-#include <filesystem>
+#include <chrono>
+#include <utility>
+#include <string>
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
-constexpr uint32_t kScreenWidth = 1920;
-constexpr uint32_t kScreenHeight = 1080;
+#include "DeviceMemoryAllocator.h"
+#include "ReadbackBufferPool.h"
+#include "PipelineCacheFile.h"
+#include "GpuTimestampPool.h"
+#include "Trace.h"
+#include "LayerConfig.h"
+#include "EncoderPool.h"
+#include "ParallelFor.h"
+#include "QueueTopology.h"
+#include "CommandBufferCache.h"
+#include "SecondaryCommandRecorder.h"
+#include "GpuTimeline.h"
+#include "VertexSample.h"
+#include "FragmentSample.h"
+
+// --sizew肵Ȃꍇ̉𑜓x
+constexpr uint32_t kDefaultScreenWidth = 1920;
+constexpr uint32_t kDefaultScreenHeight = 1080;
+
+static std::string AppName = "Vulkan Test";
+static std::string EngineName = "Vulkan.hpp";
+
+/**
+ * @brief `挋ʂCPUǂޕ@
+ */
+enum class ReadbackMode
+{
+    // Linearȃ_[^[QbggLinearAgȂCopy
+    Auto,
+
+    // OptimalȃC[WcopyImageToBufferœǂݏopobt@փRs[
+    Copy,
+
+    // HostVisibleȃɒuLinearȃC[W֕`悵ARs[ɂ̂܂ܓǂ
+    Linear,
+};
+
+/**
+ * @brief o͂摜t@Č`
+ */
+enum class ImageFormat
+{
+    Bmp,
+
+    // deflatedeflate_threads̃XbhŃ`NɕĈk
+    Png,
+
+    // vr[pBFϊADCTAʎqCPUΉĂSIMDōsB
+    // Ggs[deflate_threads̃XbhŁAX^[g}[J[ŋ؂тƂɍs
+    Jpg,
+};
+
+/**
+ * @brief 1񕪂̕`̉𑜓xƃtH[}bg
+ */
+struct RenderJob
+{
+    vk::Extent2D extent;
+    vk::Format format = vk::Format::eR8G8B8A8Unorm;
+};
+
+/**
+ * @brief R}hCŎw肷sIvV
+ */
+struct AppOptions
+{
+    // `悷t[
+    uint32_t frame_count = 1;
+
+    // GPU֓Ăt[
+    uint32_t frames_in_flight = 1;
+
+    // `̑ɁA^CvƂ̓ǂݏoшv
+    bool bench_readback = false;
+
+    // 1t[ŋL^h[R[̐i`惊Xg̒j
+    uint32_t draw_count = 1;
+
+    // `惊XgZJ_R}hobt@֕SċL^Xbh̐i1ȂvC}֒ڋL^j
+    uint32_t record_threads = 1;
+
+    // `̑ɁAXbhƂ̕`惊Xg̋L^Ԃv
+    bool bench_record = false;
+
+    // 1t[ŕ`悷oG[V̐Bꂼ_[^[Qbg̔z񃌃C[֕`Aʂ̃t@Cɏo
+    uint32_t layer_count = 1;
+
+    // pCvCLbṼt@CiȂLbVgȂj
+    std::string pipeline_cache_path = "pipeline_cache.bin";
+
+    // `挋ʂ̓ǂݏo@
+    ReadbackMode readback_mode = ReadbackMode::Auto;
+
+    // OtBbNXƂ͕ʂ̃t@~̃L[΁AǂݏõRs[̃L[ōs
+    bool transfer_queue = true;
+
+    // foCXΉĂ΁AM̊^CCZ}tHŒǐՂigȂ΃tFXj
+    bool timeline_semaphore = true;
+
+    // t[Ƃ̌vʂJSON Linesŏot@CiȂ珑oȂj
+    std::string stats_json_path;
+
+    // CPȔԂChromẽg[X`ŏot@CiȂL^Ȃj
+    std::string trace_path;
+
+    // Lɂof[Vi͊ϐAȂ΃rh\Ō܂j
+    ValidationMode validation_mode = ValidationMode::None;
+
+    // `̑ɁAof[Ṽ[hƂ̎sԂv
+    bool bench_layers = false;
+
+    // 摜GR[h郏[J[Xbh̐i0Ȃ`惋[ṽXbhŃGR[hj
+    uint32_t encode_threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+
+    // GR[h҂̃t[ς߂鐔i0Ȃ烏[J[2{j
+    uint32_t encode_queue_depth = 0;
+
+    // o͂摜t@Č`
+    ImageFormat image_format = ImageFormat::Bmp;
+
+    // PNGdeflatëkxistbi_write_png_compression_levelA傫قǒxj
+    int png_compression_level = 8;
+
+    // 1PNGdeflateiJPEGȂGgs[j𕪒SXbh̐i1Ȃ番Ȃj
+    uint32_t deflate_threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+
+    // JPEG̕ii1`100Astbi_write_jpgqualityj
+    int jpg_quality = 90;
+
+    // ɕ`悷Wui--sizeƂ1j
+    std::vector<RenderJob> jobs;
+
+    /**
+     * @brief R}hC߂
+     * @param argc ̐
+     * @param argv 
+     * @return ߂IvV
+     */
+    static AppOptions Parse(const int argc, char** argv)
+    {
+        AppOptions options;
+        options.validation_mode = LayerConfig::DefaultMode();
+
+        // ȍ~--sizeɓKptH[}bg
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+
+            // l1IvV̒lo
+            const auto next_value = [&]() -> uint32_t
+            {
+                if (i + 1 >= argc)
+                {
+                    throw std::invalid_argument(arg + " requires a value");
+                }
+                return static_cast<uint32_t>(std::stoul(argv[++i]));
+            };
+
+            const auto next_string = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                {
+                    throw std::invalid_argument(arg + " requires a value");
+                }
+                return argv[++i];
+            };
+
+            if (arg == "--frames")
+            {
+                options.frame_count = next_value();
+            }
+            else if (arg == "--in-flight")
+            {
+                options.frames_in_flight = next_value();
+            }
+            else if (arg == "--bench-readback")
+            {
+                options.bench_readback = true;
+            }
+            else if (arg == "--pipeline-cache")
+            {
+                options.pipeline_cache_path = next_string();
+            }
+            else if (arg == "--no-pipeline-cache")
+            {
+                options.pipeline_cache_path.clear();
+            }
+            else if (arg == "--stats-json")
+            {
+                options.stats_json_path = next_string();
+            }
+            else if (arg == "--trace")
+            {
+                options.trace_path = next_string();
+            }
+            else if (arg == "--validation")
+            {
+                const std::string mode = next_string();
+                if (!LayerConfig::ParseMode(mode, options.validation_mode))
+                {
+                    throw std::invalid_argument("--validation must be none, standard or gpu");
+                }
+            }
+            else if (arg == "--bench-layers")
+            {
+                options.bench_layers = true;
+            }
+            else if (arg == "--encode-threads")
+            {
+                options.encode_threads = next_value();
+            }
+            else if (arg == "--encode-queue")
+            {
+                options.encode_queue_depth = next_value();
+            }
+            else if (arg == "--image-format")
+            {
+                const std::string name = next_string();
+                if (name == "bmp")
+                {
+                    options.image_format = ImageFormat::Bmp;
+                }
+                else if (name == "png")
+                {
+                    options.image_format = ImageFormat::Png;
+                }
+                else if (name == "jpg")
+                {
+                    options.image_format = ImageFormat::Jpg;
+                }
+                else
+                {
+                    throw std::invalid_argument("--image-format must be bmp, png or jpg");
+                }
+            }
+            else if (arg == "--png-level")
+            {
+                options.png_compression_level = static_cast<int>(next_value());
+            }
+            else if (arg == "--deflate-threads")
+            {
+                options.deflate_threads = next_value();
+            }
+            else if (arg == "--jpg-quality")
+            {
+                options.jpg_quality = static_cast<int>(next_value());
+                if (options.jpg_quality < 1 || options.jpg_quality > 100)
+                {
+                    throw std::invalid_argument("--jpg-quality must be between 1 and 100");
+                }
+            }
+            else if (arg == "--size")
+            {
+                const std::string size = next_string();
+
+                RenderJob job;
+                char separator = 0;
+                char trailing = 0;
+                if (std::sscanf(size.c_str(), "%u%c%u%c", &job.extent.width, &separator, &job.extent.height, &trailing) != 3 ||
+                    separator != 'x' || job.extent.width == 0 || job.extent.height == 0)
+                {
+                    throw std::invalid_argument("--size must be WIDTHxHEIGHT: " + size);
+                }
+                job.format = format;
+                options.jobs.push_back(job);
+            }
+            else if (arg == "--format")
+            {
+                // stbi_write_bmpւ̂܂ܓnARGBA8rbg̃tH[}bg󂯕t
+                const std::string name = next_string();
+                if (name == "unorm")
+                {
+                    format = vk::Format::eR8G8B8A8Unorm;
+                }
+                else if (name == "srgb")
+                {
+                    format = vk::Format::eR8G8B8A8Srgb;
+                }
+                else
+                {
+                    throw std::invalid_argument("--format must be unorm or srgb");
+                }
+            }
+            else if (arg == "--readback")
+            {
+                const std::string mode = next_string();
+                if (mode == "auto")
+                {
+                    options.readback_mode = ReadbackMode::Auto;
+                }
+                else if (mode == "copy")
+                {
+                    options.readback_mode = ReadbackMode::Copy;
+                }
+                else if (mode == "linear")
+                {
+                    options.readback_mode = ReadbackMode::Linear;
+                }
+                else
+                {
+                    throw std::invalid_argument("--readback must be auto, copy or linear");
+                }
+            }
+            else if (arg == "--timeline-semaphore")
+            {
+                const std::string mode = next_string();
+                if (mode == "on")
+                {
+                    options.timeline_semaphore = true;
+                }
+                else if (mode == "off")
+                {
+                    options.timeline_semaphore = false;
+                }
+                else
+                {
+                    throw std::invalid_argument("--timeline-semaphore must be on or off");
+                }
+            }
+            else if (arg == "--draws")
+            {
+                options.draw_count = next_value();
+            }
+            else if (arg == "--record-threads")
+            {
+                options.record_threads = next_value();
+            }
+            else if (arg == "--bench-record")
+            {
+                options.bench_record = true;
+            }
+            else if (arg == "--layers")
+            {
+                options.layer_count = next_value();
+            }
+            else if (arg == "--transfer-queue")
+            {
+                const std::string mode = next_string();
+                if (mode == "on")
+                {
+                    options.transfer_queue = true;
+                }
+                else if (mode == "off")
+                {
+                    options.transfer_queue = false;
+                }
+                else
+                {
+                    throw std::invalid_argument("--transfer-queue must be on or off");
+                }
+            }
+            else
+            {
+                throw std::invalid_argument("unknown option: " + arg + "\n" +
+                    "usage: " + argv[0] + " [--frames N] [--in-flight K] [--bench-readback]"
+                    " [--pipeline-cache PATH | --no-pipeline-cache] [--readback auto|copy|linear] [--transfer-queue on|off] [--timeline-semaphore on|off]"
+                    " [--format unorm|srgb] [--size WxH]... [--stats-json PATH] [--trace PATH]"
+                    " [--validation none|standard|gpu] [--bench-layers] [--encode-threads N] [--encode-queue N]"
+                    " [--image-format bmp|png|jpg] [--png-level N] [--deflate-threads N] [--jpg-quality N]"
+                    " [--draws N] [--record-threads N] [--bench-record] [--layers N]");
+            }
+        }
+
+        if (options.frame_count == 0 || options.frames_in_flight == 0)
+        {
+            throw std::invalid_argument("--frames and --in-flight must be at least 1");
+        }
+
+        if (options.draw_count == 0 || options.record_threads == 0)
+        {
+            throw std::invalid_argument("--draws and --record-threads must be at least 1");
+        }
+
+        if (options.layer_count == 0)
+        {
+            throw std::invalid_argument("--layers must be at least 1");
+        }
+
+        if (options.layer_count > 1 && options.readback_mode == ReadbackMode::Linear)
+        {
+            throw std::invalid_argument("--readback linear cannot be used with --layers (a linear image has a single layer)");
+        }
+
+        if (options.encode_queue_depth == 0)
+        {
+            options.encode_queue_depth = std::max(1u, options.encode_threads * 2);
+        }
+
+        if (options.jobs.empty())
+        {
+            options.jobs.push_back({ vk::Extent2D(kDefaultScreenWidth, kDefaultScreenHeight), format });
+        }
+
+        return options;
+    }
+};
+
+/**
+ * @brief tF[YƂ̌oߎ(EH[NbN)vĕ\
+ *
+ * g[XLȂAtF[Y̓g[X̋ԂƂĂL^
+ */
+class PhaseTimer
+{
+public:
+    /**
+     * @brief funcsǍoߎԂnameƂċL^
+     * @param name tF[Y
+     * @param func v鏈
+     * @return oߎԁi~bj
+     */
+    template <typename Func>
+    double Measure(const char* name, Func&& func)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        {
+            TRACE_SCOPE(name);
+            func();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        phases_.emplace_back(name, elapsed_ms);
+        return elapsed_ms;
+    }
+
+    /**
+     * @brief L^tF[YƂ̌oߎԂƍv\
+     */
+    void Print() const
+    {
+        double total_ms = 0.0;
+
+        std::cout << "phase timing:" << std::endl;
+        for (const auto& [name, ms] : phases_)
+        {
+            std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3) << std::setw(10) << ms << " ms" << std::endl;
+            total_ms += ms;
+        }
+        std::cout << "  " << std::left << std::setw(24) << "total" << std::right << std::fixed << std::setprecision(3) << std::setw(10) << total_ms << " ms" << std::endl;
+        std::cout.unsetf(std::ios_base::floatfield | std::ios_base::adjustfield);
+    }
+
+private:
+    std::vector<std::pair<const char*, double>> phases_;
+};
+
+class App
+{
+public:
+    explicit App(const AppOptions& options) : options_(options)
+    {
+    }
+
+    void run()
+    {
+        if (!options_.trace_path.empty())
+        {
+            Tracer::Get().Start();
+        }
+
+        {
+            TRACE_SCOPE("InitVulkan");
+            InitVulkan();
+        }
+
+        for (job_index_ = 0; job_index_ < options_.jobs.size(); job_index_++)
+        {
+            TRACE_SCOPE("Job", "job", static_cast<int64_t>(job_index_));
+
+            // ŏ̃Wũ_[^[QbgInitVulkanŗpӍς
+            if (job_index_ > 0)
+            {
+                PhaseTimer job_timer;
+                PrepareJob(options_.jobs[job_index_], job_timer);
+                job_timer.Print();
+            }
+
+            if (options_.bench_readback)
+            {
+                BenchmarkReadback();
+                BenchmarkRenderTargets();
+            }
+            else if (options_.bench_record)
+            {
+                BenchmarkRecording();
+            }
+            else
+            {
+                RenderFrames();
+            }
+        }
+
+        {
+            TRACE_SCOPE("CleanUp");
+            CleanUp();
+        }
+
+        if (!options_.trace_path.empty())
+        {
+            Tracer::Get().StopAndWrite(options_.trace_path);
+        }
+    }
+
+private:
+    /**
+     * @brief GPU֓łt[1̃\[X
+     */
+    struct FrameContext
+    {
+        // O̒̈ʒui^CX^vNG̃Xbgj
+        uint32_t slot = 0;
+
+        // `̃R}hobt@Bǂݏõobt@ƂɈxL^Aȍ~͋L^ɑM
+        CommandBufferCache commands;
+
+        // ]L[œǂݏõRs[sR}hobt@iǂݏo悲ƁjƁA`̊̃L[֓`Z}tH
+        CommandBufferCache copy_commands;
+        vk::UniqueSemaphore render_done;
+
+        // `惊Xg𕪒SċL^ZJ_R}hobt@irecord_threads1ȂgȂjB
+        // ̃t[ׂ̂ẴvC}ŝŁA_[^[Qbg蒼܂ŋL^Ȃ
+        SecondaryCommandRecorder draws;
+
+        // ̃t[ŋL^ς݂̃R}hobt@𑗐M
+        bool cmd_buf_reused = false;
+
+        // Ō̑MǐՂ^CCƁȂMɐUꂽli]L[gƂ̓Rs[̑Mj
+        GpuTimeline* timeline = nullptr;
+        uint64_t timeline_value = 0;
+
+        vk::UniqueImage image;
+        DeviceMemoryAllocator::Allocation image_alloc;
+
+        // C[W̔z񃌃C[̐i1t[ŕ`oG[V̐jƁAC[Ƃ̃r[ƃt[obt@
+        uint32_t layer_count = 1;
+        std::vector<vk::UniqueImageView> image_views;
+        std::vector<vk::UniqueFramebuffer> framebuffers;
+
+        // HostVisibleȃɒuLinearȃC[Wî܂CPUǂށjBCreateImagȇOɌĂяo߂
+        bool linear = false;
+
+        // 쐬C[W̃^CO
+        vk::ImageTiling tiling = vk::ImageTiling::eOptimal;
+
+        // LinearȃC[W̃̔zu
+        vk::SubresourceLayout linear_layout;
+
+        // ǂݏopobt@̃CfbNXireadback_pool_؂ĂԂLj
+        uint32_t readback_index = 0;
+
+        // ̃t[ԍ
+        uint32_t frame_index = 0;
+
+        // GPUɑMāA܂ǂݏoĂȂ
+        bool pending = false;
+
+        // M
+        std::chrono::steady_clock::time_point submit_time;
+    };
+
+    /**
+     * @brief 1t[̌v
+     */
+    struct FrameRecord
+    {
+        uint32_t frame_index = 0;
+
+        // t[̒̃oG[Viz񃌃C[j̔ԍ
+        uint32_t layer = 0;
+
+        // M珑o܂ł̎
+        double latency_ms = 0.0;
+
+        // CPUŉ摜GR[hďo
+        double encode_ms = 0.0;
+
+        // GPŨ_[pXcopyImageToBuffer̎ԁivłȂΕj
+        double gpu_render_ms = -1.0;
+        double gpu_copy_ms = -1.0;
+
+        // L^ς݂̃R}hobt@𑗐MifalseȂL^j
+        bool cmd_buf_reused = false;
+    };
+
+    AppOptions options_;
+
+    // Lɂ郌C[Ɗg
+    LayerConfig layer_config_;
+
+    // VulkanCX^X
+	vk::UniqueInstance instance_;
+
+    // ׂĂ̕foCX
+	std::vector<vk::PhysicalDevice> physical_devices_;
+
+    // Vulkangp镨foCX
+	vk::PhysicalDevice physical_device_;
+
+    vk::PhysicalDeviceMemoryProperties physical_device_mem_props_;
+
+    // OtBbNXT|[gL[t@~Ă镨foCX݂邩
+    bool exists_suitable_physical_device_ = false;
+
+    // prƂɎgL[t@~
+    QueueTopology queue_topology_;
+
+    // OtBbNXT|[gL[t@~̃CfbNXi1j
+    uint32_t graphics_queue_family_index_;
+
+    // _foCX
+    vk::UniqueDevice device_;
+
+    // OtBbNXL[i1j
+    vk::Queue graphics_queue_;
+
+    vk::UniqueCommandPool cmd_pool_;
+
+    // `惊XgZJ_R}hobt@֋L^郏[J[iĂяoXbh܂߂record_threadsj
+    ParallelFor record_workers_;
+
+    // ǂݏõRs[]L[ōsĩt@~A--transfer-queue offłȂƂj
+    bool copy_on_transfer_queue_ = false;
+
+    // ]L[ƁÃt@~̃R}hv[
+    vk::Queue transfer_queue_;
+    vk::UniqueCommandPool transfer_cmd_pool_;
+
+    // M̊^CCZ}tHŒǐՂ邩ifoCXΉA--timeline-semaphore offłȂƂj
+    bool use_timeline_semaphore_ = false;
+
+    // L[Ƃ̑M̊̒ǐ
+    GpuTimeline graphics_timeline_;
+    GpuTimeline transfer_timeline_;
+
+    // C[Wƃobt@̃؂oTuAP[^ig\[Xɐ錾j
+    DeviceMemoryAllocator allocator_;
+
+    // t[Ƃ̃\[Xiframes_in_flight̃Oj
+    std::vector<FrameContext> frames_;
+
+    // iIɃ}bvǂݏopobt@iLinearȃ_[^[Qbggꍇ͕svj
+    ReadbackBufferPool readback_pool_;
+
+    // Linearȃ_[^[Qbg֕`悵ARs[ɓǂނ
+    bool linear_render_target_ = false;
+
+    // Linearȃ_[^[QbgɊ蓖ĂHostVisibleȃ^Cv
+    uint32_t linear_memory_type_index_ = 0;
+
+    // `撆̃WũCfbNX
+    size_t job_index_ = 0;
+
+    // ̃_[^[Qbg̉𑜓xƃtH[}bgi܂쐬ĂȂ0eUndefinedj
+    vk::Extent2D extent_;
+    vk::Format format_ = vk::Format::eUndefined;
+
+
+    vk::UniqueRenderPass renderpass_;
+
+    // fBXNɕۑpCvCLbV
+    std::unique_ptr<PipelineCacheFile> pipeline_cache_file_;
+    vk::UniquePipelineCache pipeline_cache_;
+
+    vk::UniquePipeline pipeline_;
+
+    vk::UniqueShaderModule vert_shader_;
+    vk::UniqueShaderModule frag_shader_;
+
+    // tF[YƂ̌oߎ
+    PhaseTimer phase_timer_;
+
+    // t[ƂGPUԂv^CX^vNG
+    GpuTimestampPool gpu_timestamps_;
+
+    // t[Ƃ̌vʁiGR[_[̃Xbhǉ̂records_mutex_Ŏj
+    std::vector<FrameRecord> frame_records_;
+    std::mutex records_mutex_;
+
+    // vʂ1t[1sJSONŏot@C
+    std::ofstream stats_json_;
+
+    // 1PNGdeflateJPEG̃Ggs[𕪒S郏[J[iGR[_[̃^XNĝŁAencoder_pool_ɐ錾j
+    ParallelFor deflate_workers_;
+
+    // 摜̃GR[hƏos[J[iǂݏopobt@thisQƂ^XN̂ŁAŌɐ錾čŏɔjj
+    EncoderPool encoder_pool_;
+
+    /**
+     * @brief VulkanCX^X̍쐬
+     */
+    void CreateInstance()
+    {
+        // vk::ApplicationInfõCX^X
+        const vk::ApplicationInfo application_info(AppName.c_str(), 1, EngineName.c_str(), 1, VK_API_VERSION_1_2);
+
+        // CXg[Ă郌C[𒲂ׂāALɂ郌C[Ɗg߂
+        layer_config_.Configure(options_.validation_mode);
+
+        // vk::InstanceCreateInfõCX^X
+        vk::InstanceCreateInfo instance_create_info({}, &application_info);
+
+        instance_create_info.pNext = layer_config_.InstanceCreateInfoNext();
+        instance_create_info.enabledLayerCount = static_cast<uint32_t>(layer_config_.Layers().size());
+        instance_create_info.ppEnabledLayerNames = layer_config_.Layers().data();
+        instance_create_info.enabledExtensionCount = static_cast<uint32_t>(layer_config_.InstanceExtensions().size());
+        instance_create_info.ppEnabledExtensionNames = layer_config_.InstanceExtensions().data();
+
+        // VulkañCX^X
+        instance_ = vk::createInstanceUnique(instance_create_info);
+    }
+
+    /**
+     * @brief foCX̎擾
+     */
+    void GetPhysicalDevices()
+    {
+        // foCX̎擾
+        physical_devices_ = instance_->enumeratePhysicalDevices();
+    }
+
+    /**
+     * @brief foCXׂ̂ẴL[t@~̏\
+     */
+    void PrintPhysicalDevices() const
+    {
+        VkPhysicalDeviceProperties physical_device_properties;
+        for (size_t i = 0; i < physical_devices_.size(); i++)
+        {
+            physical_device_properties = physical_devices_[i].getProperties();
+            std::cout << physical_device_properties.deviceName << std::endl;
+
+            std::vector<vk::QueueFamilyProperties> queueProps = physical_devices_[i].getQueueFamilyProperties();
+
+            // foCXׂ̂ẴL[t@~̏\
+            std::cout << "queue family count: " << queueProps.size() << std::endl;
+            std::cout << std::endl;
+            for (size_t i = 0; i < queueProps.size(); i++)
+            {
+                std::cout << "queue family index: " << i << std::endl;
+                std::cout << "  queue count: " << queueProps[i].queueCount << std::endl;
+                std::cout << "  graphic support: " << (queueProps[i].queueFlags & vk::QueueFlagBits::eGraphics ? "True" : "False") << std::endl;
+                std::cout << "  compute support: " << (queueProps[i].queueFlags & vk::QueueFlagBits::eCompute ? "True" : "False") << std::endl;
+                std::cout << "  transfer support: " << (queueProps[i].queueFlags & vk::QueueFlagBits::eTransfer ? "True" : "False") << std::endl;
+                std::cout << std::endl;
+            }
+        }
+    }
+
+    /**
+     * @brief OtBbNXT|[gL[t@~Œł1Ă镨foCXI
+     *
+     * ]pƔ񓯊Rs[g̃L[t@~ŒTĂ
+     */
+    void SelectPhysicalDevice()
+    {
+        for (size_t i = 0; i < physical_devices_.size(); i++)
+        {
+            if (queue_topology_.Select(physical_devices_[i]))
+            {
+                physical_device_ = physical_devices_[i];
+                graphics_queue_family_index_ = queue_topology_.GraphicsFamily();
+                exists_suitable_physical_device_ = true;
+                break;
+            }
+        }
+
+        if (!exists_suitable_physical_device_)
+        {
+            std::cerr << "gp\ȕfoCX܂" << std::endl;
+            throw std::runtime_error("gp\ȕfoCX܂");
+        }
+
+        std::cout << "gpfoCX:" << physical_device_.getProperties().deviceName << std::endl;
+        queue_topology_.Print();
+
+        // foCX̃
+        physical_device_mem_props_ = physical_device_.getMemoryProperties();
+    }
+
+    /**
+     * @brief _foCX̍쐬ƃL[̎擾
+     */
+    void CreateLogicalDevice()
+    {
+        vk::DeviceCreateInfo device_create_info;
+
+        copy_on_transfer_queue_ = options_.transfer_queue && queue_topology_.HasTransferFamily();
+
+        // _foCXɃL[̎gp`i]L[gȂ炻̃t@~̃L[j
+        const std::vector<vk::DeviceQueueCreateInfo> queue_create_infos = queue_topology_.QueueCreateInfos(copy_on_transfer_queue_);
+
+        device_create_info.pQueueCreateInfos = queue_create_infos.data();
+        device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
+
+        // of[VC[ifoCXC[͔񐄏AÂ[_[̂߂ɃCX^XƑj
+        device_create_info.enabledLayerCount = static_cast<uint32_t>(layer_config_.Layers().size());
+        device_create_info.ppEnabledLayerNames = layer_config_.Layers().data();
+
+        // ^CCZ}tH̋@\Lɂ
+        use_timeline_semaphore_ = options_.timeline_semaphore && GpuTimeline::IsSupported(physical_device_);
+        vk::PhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features;
+        if (use_timeline_semaphore_)
+        {
+            timeline_semaphore_features.timelineSemaphore = VK_TRUE;
+            device_create_info.pNext = &timeline_semaphore_features;
+        }
+
+        // _foCX̍쐬
+        device_ = physical_device_.createDeviceUnique(device_create_info);
+
+        // L[̎擾
+        graphics_queue_ = device_->getQueue(graphics_queue_family_index_, 0);
+        graphics_timeline_.Init(device_.get(), graphics_queue_, use_timeline_semaphore_);
+        if (copy_on_transfer_queue_)
+        {
+            transfer_queue_ = device_->getQueue(queue_topology_.TransferFamily(), 0);
+            transfer_timeline_.Init(device_.get(), transfer_queue_, use_timeline_semaphore_);
+        }
+
+        std::cout << "readback copy queue: " << (copy_on_transfer_queue_ ? "transfer (family " + std::to_string(queue_topology_.TransferFamily()) + ")" : std::string("graphics")) << std::endl;
+        std::cout << "submission tracking: " << (use_timeline_semaphore_ ? "timeline semaphores" : "fences") << std::endl;
+
+        // ̃TuAP[^̏
+        allocator_.Init(physical_device_, device_.get());
+    }
+
+    void CreateCommandPool()
+    {
+        vk::CommandPoolCreateInfo cmd_pool_create_info;
+
+        // ł̃R}hobt@𑗐MƂɑΏۂƂL[
+        cmd_pool_create_info.queueFamilyIndex = graphics_queue_family_index_;
+
+        // L^R}hobt@ʂɃZbg
+        cmd_pool_create_info.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+
+        cmd_pool_ = device_->createCommandPoolUnique(cmd_pool_create_info);
+
+        if (copy_on_transfer_queue_)
+        {
+            cmd_pool_create_info.queueFamilyIndex = queue_topology_.TransferFamily();
+            transfer_cmd_pool_ = device_->createCommandPoolUnique(cmd_pool_create_info);
+        }
+    }
+
+    /**
+     * @brief t[ƂɁAL^R}hobt@ĂLbVpӂiR}hobt@͍ŏɎgƂɊmۂj
+     */
+    void CreateCommandBuffers()
+    {
+        for (FrameContext& frame : frames_)
+        {
+            frame.commands.Init(device_.get(), cmd_pool_.get());
+            if (copy_on_transfer_queue_)
+            {
+                frame.copy_commands.Init(device_.get(), transfer_cmd_pool_.get());
+            }
+            if (options_.record_threads > 1)
+            {
+                frame.draws.Init(device_.get(), graphics_queue_family_index_, options_.record_threads);
+            }
+        }
+
+        record_workers_.Start(options_.record_threads);
+        std::cout << "recording: " << options_.draw_count << " draws";
+        if (options_.record_threads > 1)
+        {
+            std::cout << " into secondary command buffers on " << record_workers_.ThreadCount() << " threads";
+        }
+        std::cout << std::endl;
+    }
+
+    /**
+     * @brief t[Ƃ̃\[XpӂA]L[֕`̊`Z}tH쐬
+     */
+    void CreateFrameContexts()
+    {
+        frames_.resize(std::min(options_.frames_in_flight, options_.frame_count));
+
+        for (uint32_t i = 0; i < frames_.size(); i++)
+        {
+            frames_[i].slot = i;
+            if (copy_on_transfer_queue_)
+            {
+                frames_[i].render_done = device_->createSemaphoreUnique(vk::SemaphoreCreateInfo());
+            }
+        }
+    }
+
+    /**
+     * @brief 摜obt@̗v郁^CvƎgp@\gCfbNXԂ
+     * @param request_type_filter v郁^Cv
+     * @param properties ̋@\
+     * @return ̃CfbNX
+     */
+    uint32_t FindMemoryType(const uint32_t request_type_filter, const vk::MemoryPropertyFlags properties) const
+    {
+	    const vk::PhysicalDeviceMemoryProperties physical_device_memory_properties = physical_device_.getMemoryProperties();
+
+        for (uint32_t i = 0; i < physical_device_memory_properties.memoryTypeCount; i++) {
+            if ((request_type_filter & (1 << i)) && (physical_device_memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    /**
+     * @brief CPUǂݏoobt@Ɏg^CvI
+     *
+     * CgRoC̃ALbVȃCPU̓ǂݏoɒ[ɒx̂ŁA
+     * HostCachedȃD悵AȂHostVisibleȃőË
+     * @param request_type_filter v郁^Cv
+     * @return ̃CfbNX
+     */
+    uint32_t FindReadbackMemoryType(const uint32_t request_type_filter) const
+    {
+        const vk::MemoryPropertyFlags candidates[] = {
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached | vk::MemoryPropertyFlagBits::eHostCoherent,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            vk::MemoryPropertyFlagBits::eHostVisible,
+        };
+
+        for (const vk::MemoryPropertyFlags properties : candidates)
+        {
+            try
+            {
+                const uint32_t memory_type_index = FindMemoryType(request_type_filter, properties);
+
+                std::cout << "readback memory type: " << memory_type_index << " "
+                    << vk::to_string(physical_device_mem_props_.memoryTypes[memory_type_index].propertyFlags)
+                    << " (heap " << physical_device_mem_props_.memoryTypes[memory_type_index].heapIndex << ")" << std::endl;
+
+                return memory_type_index;
+            }
+            catch (const std::runtime_error&)
+            {
+                // ̌
+            }
+        }
+
+        throw std::runtime_error("Failed to find host visible memory type for readback!");
+    }
+
+    /**
+     * @brief _[^[Qbg̃C[W̍쐬Ԃ
+     *
+     * OptimalȃC[W̓ob`̃oG[V̐z񃌃C[
+     * @param linear LinearȃC[Wɂ邩
+     */
+    vk::ImageCreateInfo GetImageCreateInfo(const bool linear) const
+    {
+        vk::ImageCreateInfo image_create_info;
+        image_create_info.imageType = vk::ImageType::e2D;
+        image_create_info.extent = vk::Extent3D(extent_.width, extent_.height, 1);
+        image_create_info.mipLevels = 1;
+        image_create_info.arrayLayers = linear ? 1 : options_.layer_count;
+        image_create_info.format = format_;
+        image_create_info.tiling = linear ? vk::ImageTiling::eLinear : vk::ImageTiling::eOptimal;
+        image_create_info.initialLayout = vk::ImageLayout::eUndefined;
+        image_create_info.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment;
+    	image_create_info.sharingMode = vk::SharingMode::eExclusive;
+        image_create_info.samples = vk::SampleCountFlagBits::e1;
+        return image_create_info;
+    }
+
+    /**
+     * @brief LinearȃC[WHostVisibleȃɒuă_[^[Qbgɂł邩ׂ
+     *
+     * gꍇlinear_memory_type_index_Ƀ^Cvݒ肷
+     * @return g邩
+     */
+    bool ProbeLinearRenderTarget()
+    {
+        const vk::ImageCreateInfo image_create_info = GetImageCreateInfo(true);
+
+        const vk::FormatProperties format_properties = physical_device_.getFormatProperties(image_create_info.format);
+        if (!(format_properties.linearTilingFeatures & vk::FormatFeatureFlagBits::eColorAttachment))
+        {
+            std::cout << "linear render target: color attachment is not supported with linear tiling" << std::endl;
+            return false;
+        }
+
+        try
+        {
+            const vk::ImageFormatProperties image_format_properties = physical_device_.getImageFormatProperties(
+                image_create_info.format, image_create_info.imageType, image_create_info.tiling, image_create_info.usage);
+
+            if (image_format_properties.maxExtent.width < extent_.width || image_format_properties.maxExtent.height < extent_.height)
+            {
+                std::cout << "linear render target: " << extent_.width << "x" << extent_.height << " exceeds the maximum extent" << std::endl;
+                return false;
+            }
+        }
+        catch (const vk::SystemError&)
+        {
+            std::cout << "linear render target: image usage is not supported with linear tiling" << std::endl;
+            return false;
+        }
+
+        // LinearȃC[Wu郁^Cv́AɍC[WŒׂ
+        const vk::UniqueImage probe_image = device_->createImageUnique(image_create_info);
+        const vk::MemoryRequirements image_mem_req = device_->getImageMemoryRequirements(probe_image.get());
+
+        try
+        {
+            linear_memory_type_index_ = FindReadbackMemoryType(image_mem_req.memoryTypeBits);
+        }
+        catch (const std::runtime_error&)
+        {
+            std::cout << "linear render target: no host visible memory type" << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief `挋ʂ̓ǂݏo@߂
+     */
+    void SelectReadbackMode()
+    {
+        switch (options_.readback_mode)
+        {
+        case ReadbackMode::Copy:
+            linear_render_target_ = false;
+            break;
+        case ReadbackMode::Linear:
+            if (!ProbeLinearRenderTarget())
+            {
+                throw std::runtime_error("Linear render target is not supported on this device!");
+            }
+            linear_render_target_ = true;
+            break;
+        case ReadbackMode::Auto:
+            // LinearȃC[W͔z񃌃C[ĂȂ̂ŁAob`̓Rs[œǂݏo
+            linear_render_target_ = options_.layer_count == 1 && ProbeLinearRenderTarget();
+            break;
+        }
+
+        std::cout << "readback mode: " << (linear_render_target_ ? "linear (read the render target in place)" : "copy (copyImageToBuffer)") << std::endl;
+    }
+
+    /**
+     * @brief frame.linearŎw肵^COŃC[W쐬A蓖Ă
+     */
+    void CreateImage(FrameContext& frame)
+    {
+        /* C[W̍쐬 */
+
+        const vk::ImageCreateInfo image_create_info = GetImageCreateInfo(frame.linear);
+        frame.image = device_->createImageUnique(image_create_info);
+        frame.tiling = image_create_info.tiling;
+        frame.layer_count = image_create_info.arrayLayers;
+
+        /* C[W̃m */
+
+        if (!frame.linear)
+        {
+            frame.image_alloc = allocator_.AllocateForImage(frame.image.get(), vk::MemoryPropertyFlagBits::eDeviceLocal, false);
+            return;
+        }
+
+        // CPU璼ړǂނ̂HostVisibleȃɒu
+        const vk::MemoryRequirements image_mem_req = device_->getImageMemoryRequirements(frame.image.get());
+        frame.image_alloc = allocator_.Allocate(image_mem_req, linear_memory_type_index_, true);
+        device_->bindImageMemory(frame.image.get(), frame.image_alloc.memory, frame.image_alloc.offset);
+
+        // s̊Ԃɗ]邱Ƃ̂ŁAzu₢킹Ă
+        frame.linear_layout = device_->getImageSubresourceLayout(frame.image.get(), vk::ImageSubresource(vk::ImageAspectFlagBits::eColor, 0, 0));
+    }
+
+    /**
+     * @brief ǂݏopobt@̃v[쐬
+     *
+     * GPUɓ̃t[ƁAGR[_[Ăt[ꂼ1g
+     */
+    void CreateReadbackBuffers()
+    {
+        // Linearȃ_[^[Qbg͂̂܂ܓǂނ̂ŁAr̂߂̃x`}[NȊOł̓obt@͗vȂ
+        if (linear_render_target_ && !options_.bench_readback)
+        {
+            readback_pool_.Destroy();
+            return;
+        }
+
+        // ob`ׂ̂ẴC[1̃Rs[Ŏ󂯎iC[͌ԂȂɕԁj
+        const vk::DeviceSize buffer_size = vk::DeviceSize(extent_.width) * extent_.height * 4 * options_.layer_count;
+
+        // prETCỸobt@͓memoryTypeBits̂ŁAɍobt@Œׂ
+        vk::BufferCreateInfo buffer_create_info;
+        buffer_create_info.size = buffer_size;
+        buffer_create_info.usage = vk::BufferUsageFlagBits::eTransferDst;
+
+        const vk::UniqueBuffer probe_buffer = device_->createBufferUnique(buffer_create_info);
+        const vk::MemoryRequirements buffer_mem_req = device_->getBufferMemoryRequirements(probe_buffer.get());
+        const uint32_t memory_type_index = FindReadbackMemoryType(buffer_mem_req.memoryTypeBits);
+
+        // GPUɓ̃t[ɉāAGR[_[sEs҂̃t[obt@1؂
+        const uint32_t buffer_count = static_cast<uint32_t>(frames_.size()) + encoder_pool_.Capacity();
+
+        readback_pool_.Create(device_.get(), allocator_, buffer_count, buffer_size, memory_type_index);
+    }
+
+    /**
+     * @brief z񃌃C[ƂɁÃC[r[쐬
+     */
+    void CreateImageView(FrameContext& frame)
+    {
+        vk::ImageViewCreateInfo image_view_create_info;
+        image_view_create_info.image = frame.image.get();
+        image_view_create_info.viewType = vk::ImageViewType::e2D;
+        image_view_create_info.format = format_;
+        image_view_create_info.components.r = vk::ComponentSwizzle::eIdentity;
+        image_view_create_info.components.g = vk::ComponentSwizzle::eIdentity;
+        image_view_create_info.components.b = vk::ComponentSwizzle::eIdentity;
+        image_view_create_info.components.a = vk::ComponentSwizzle::eIdentity;
+        image_view_create_info.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        image_view_create_info.subresourceRange.baseMipLevel = 0;
+        image_view_create_info.subresourceRange.levelCount = 1;
+        image_view_create_info.subresourceRange.layerCount = 1;
+
+        frame.image_views.clear();
+        for (uint32_t layer = 0; layer < frame.layer_count; layer++)
+        {
+            image_view_create_info.subresourceRange.baseArrayLayer = layer;
+            frame.image_views.push_back(device_->createImageViewUnique(image_view_create_info));
+        }
+    }
+
+    void CreateRenderPass()
+    {
+        vk::AttachmentDescription attachments[1];
+        attachments[0].format = format_;
+        attachments[0].samples = vk::SampleCountFlagBits::e1;
+        attachments[0].loadOp = vk::AttachmentLoadOp::eClear;
+        attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
+        attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        attachments[0].initialLayout = vk::ImageLayout::eUndefined;
+        attachments[0].finalLayout = vk::ImageLayout::eGeneral;
+
+        vk::AttachmentReference subpass0_attachmentRefs[1];
+        subpass0_attachmentRefs[0].attachment = 0;
+        subpass0_attachmentRefs[0].layout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        vk::SubpassDescription subpasses[1];
+        subpasses[0].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpasses[0].colorAttachmentCount = 1;
+        subpasses[0].pColorAttachments = subpass0_attachmentRefs;
+
+        vk::RenderPassCreateInfo renderpass_create_info;
+        renderpass_create_info.attachmentCount = 1;
+        renderpass_create_info.pAttachments = attachments;
+        renderpass_create_info.subpassCount = 1;
+        renderpass_create_info.pSubpasses = subpasses;
+        // `挋ʂ_[pXcopyImageToBufferǂ߂悤ɂ
+        vk::SubpassDependency dependencies[1];
+        dependencies[0].srcSubpass = 0;
+        dependencies[0].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        dependencies[0].dstStageMask = vk::PipelineStageFlagBits::eTransfer;
+        dependencies[0].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        dependencies[0].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+        renderpass_create_info.dependencyCount = 1;
+        renderpass_create_info.pDependencies = dependencies;
+
+        renderpass_ = device_->createRenderPassUnique(renderpass_create_info);
+    }
+
+    /**
+     * @brief z񃌃C[ƂɃt[obt@쐬ioG[VƂɃ_[pX1񂸂sj
+     */
+    void CreateFrameBuffer(FrameContext& frame)
+    {
+        frame.framebuffers.clear();
+        for (const vk::UniqueImageView& image_view : frame.image_views)
+        {
+            vk::ImageView vk_frame_buf_attachments[1];
+            vk_frame_buf_attachments[0] = image_view.get();
+
+            vk::FramebufferCreateInfo framebuffer_create_info;
+            framebuffer_create_info.width = extent_.width;
+            framebuffer_create_info.height = extent_.height;
+            framebuffer_create_info.layers = 1;
+            framebuffer_create_info.renderPass = renderpass_.get();
+            framebuffer_create_info.attachmentCount = 1;
+            framebuffer_create_info.pAttachments = vk_frame_buf_attachments;
+
+            frame.framebuffers.push_back(device_->createFramebufferUnique(framebuffer_create_info));
+        }
+    }
+
+    void CreatePipeline()
+    {
+        // r[|[gƃVU[͓IXe[gɂāA𑜓xςĂpCvC蒼Ȃ
+        vk::PipelineViewportStateCreateInfo vk_pipeline_viewport_state_create_info;
+        vk_pipeline_viewport_state_create_info.viewportCount = 1;
+        vk_pipeline_viewport_state_create_info.pViewports = nullptr;
+        vk_pipeline_viewport_state_create_info.scissorCount = 1;
+        vk_pipeline_viewport_state_create_info.pScissors = nullptr;
+
+        const vk::DynamicState dynamic_states[2] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+
+        vk::PipelineDynamicStateCreateInfo vk_pipeline_dynamic_state_create_info;
+        vk_pipeline_dynamic_state_create_info.dynamicStateCount = 2;
+        vk_pipeline_dynamic_state_create_info.pDynamicStates = dynamic_states;
+
+        vk::PipelineVertexInputStateCreateInfo vk_pipeline_vertex_input_state_create_info;
+        vk_pipeline_vertex_input_state_create_info.vertexAttributeDescriptionCount = 0;
+        vk_pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = nullptr;
+        vk_pipeline_vertex_input_state_create_info.vertexBindingDescriptionCount = 0;
+        vk_pipeline_vertex_input_state_create_info.pVertexBindingDescriptions = nullptr;
+
+        vk::PipelineInputAssemblyStateCreateInfo vk_pipeline_input_assembly_state_create_info;
+        vk_pipeline_input_assembly_state_create_info.topology = vk::PrimitiveTopology::eTriangleList;
+        vk_pipeline_input_assembly_state_create_info.primitiveRestartEnable = false;
+
+        vk::PipelineRasterizationStateCreateInfo vk_pipeline_rasterization_state_create_info;
+        vk_pipeline_rasterization_state_create_info.depthClampEnable = false;
+        vk_pipeline_rasterization_state_create_info.rasterizerDiscardEnable = false;
+        vk_pipeline_rasterization_state_create_info.polygonMode = vk::PolygonMode::eFill;
+        vk_pipeline_rasterization_state_create_info.lineWidth = 1.0f;
+        vk_pipeline_rasterization_state_create_info.cullMode = vk::CullModeFlagBits::eBack;
+        vk_pipeline_rasterization_state_create_info.frontFace = vk::FrontFace::eClockwise;
+        vk_pipeline_rasterization_state_create_info.depthBiasEnable = false;
+
+        vk::PipelineMultisampleStateCreateInfo vk_pipeline_multisample_state_create_info;
+        vk_pipeline_multisample_state_create_info.sampleShadingEnable = false;
+        vk_pipeline_multisample_state_create_info.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+        vk::PipelineColorBlendAttachmentState vk_pipeline_color_blend_attachment_states[1];
+        vk_pipeline_color_blend_attachment_states[0].colorWriteMask =
+            vk::ColorComponentFlagBits::eA |
+            vk::ColorComponentFlagBits::eR |
+            vk::ColorComponentFlagBits::eG |
+            vk::ColorComponentFlagBits::eB;
+        vk_pipeline_color_blend_attachment_states[0].blendEnable = false;
+
+        vk::PipelineColorBlendStateCreateInfo blend;
+        blend.logicOpEnable = false;
+        blend.attachmentCount = 1;
+        blend.pAttachments = vk_pipeline_color_blend_attachment_states;
+
+        vk::PipelineLayoutCreateInfo vk_pipeline_layout_create_info;
+        vk_pipeline_layout_create_info.setLayoutCount = 0;
+        vk_pipeline_layout_create_info.pSetLayouts = nullptr;
+
+        vk::UniquePipelineLayout vk_pipeline_layout = device_->createPipelineLayoutUnique(vk_pipeline_layout_create_info);
+
+        vk::PipelineShaderStageCreateInfo vk_pipeline_shader_stage_create_infos[2];
+        vk_pipeline_shader_stage_create_infos[0].stage = vk::ShaderStageFlagBits::eVertex;
+        vk_pipeline_shader_stage_create_infos[0].module = vert_shader_.get();
+        vk_pipeline_shader_stage_create_infos[0].pName = "main";
+        vk_pipeline_shader_stage_create_infos[1].stage = vk::ShaderStageFlagBits::eFragment;
+        vk_pipeline_shader_stage_create_infos[1].module = frag_shader_.get();
+        vk_pipeline_shader_stage_create_infos[1].pName = "main";
+
+        vk::GraphicsPipelineCreateInfo vk_graphics_pipeline_create_info;
+        vk_graphics_pipeline_create_info.pViewportState = &vk_pipeline_viewport_state_create_info;
+        vk_graphics_pipeline_create_info.pVertexInputState = &vk_pipeline_vertex_input_state_create_info;
+        vk_graphics_pipeline_create_info.pInputAssemblyState = &vk_pipeline_input_assembly_state_create_info;
+        vk_graphics_pipeline_create_info.pRasterizationState = &vk_pipeline_rasterization_state_create_info;
+        vk_graphics_pipeline_create_info.pMultisampleState = &vk_pipeline_multisample_state_create_info;
+        vk_graphics_pipeline_create_info.pColorBlendState = &blend;
+        vk_graphics_pipeline_create_info.pDynamicState = &vk_pipeline_dynamic_state_create_info;
+        vk_graphics_pipeline_create_info.layout = vk_pipeline_layout.get();
+        vk_graphics_pipeline_create_info.renderPass = renderpass_.get();
+        vk_graphics_pipeline_create_info.subpass = 0;
+        vk_graphics_pipeline_create_info.stageCount = 2;
+        vk_graphics_pipeline_create_info.pStages = vk_pipeline_shader_stage_create_infos;
+
+        pipeline_ = device_->createGraphicsPipelineUnique(pipeline_cache_.get(), vk_graphics_pipeline_create_info).value;
+    }
+
+    void LoadVertShader()
+    {
+        vk::ShaderModuleCreateInfo vk_vert_shader_create_info;
+        vk_vert_shader_create_info.codeSize = sizeof(kVertexSampleSpv);
+        vk_vert_shader_create_info.pCode = kVertexSampleSpv;
+
+        vert_shader_ = device_->createShaderModuleUnique(vk_vert_shader_create_info);
+    }
+
+    void LoadFragmentShader()
+    {
+        vk::ShaderModuleCreateInfo frag_shader_create_info;
+        frag_shader_create_info.codeSize = sizeof(kFragmentSampleSpv);
+        frag_shader_create_info.pCode = kFragmentSampleSpv;
+
+        frag_shader_ = device_->createShaderModuleUnique(frag_shader_create_info);
+    }
+
+    /**
+     * @brief o͂t@CԂ
+     *
+     * Wuꍇ́AWu̔ԍƉ𑜓x𖼑OɊ܂߂i: image_1_3840x2160_0000.bmpjB
+     * oG[Vꍇ́AŌɂ̔ԍti: image_0000_v003.bmpj
+     * @param frame_index t[ԍ
+     * @param layer oG[V̔ԍ
+     * @return 1t[`悷ꍇimage.bmpAȊOimage_<t[ԍ>.bmpiPNGȂgq.pngAJPEGȂ.jpgj
+     */
+    std::string GetOutputFileName(const uint32_t frame_index, const uint32_t layer = 0) const
+    {
+        std::string file_name = "image";
+
+        char suffix[64];
+        if (options_.jobs.size() > 1)
+        {
+            std::snprintf(suffix, sizeof(suffix), "_%zu_%ux%u", job_index_, extent_.width, extent_.height);
+            file_name += suffix;
+        }
+
+        if (options_.frame_count > 1)
+        {
+            std::snprintf(suffix, sizeof(suffix), "_%04u", frame_index);
+            file_name += suffix;
+        }
+
+        if (options_.layer_count > 1)
+        {
+            std::snprintf(suffix, sizeof(suffix), "_v%03u", layer);
+            file_name += suffix;
+        }
+
+        switch (options_.image_format)
+        {
+        case ImageFormat::Png:
+            return file_name + ".png";
+        case ImageFormat::Jpg:
+            return file_name + ".jpg";
+        default:
+            return file_name + ".bmp";
+        }
+    }
+
+    /**
+     * @brief t[̕`挋ʂ}bvĂAhXԂ
+     * @param frame ǂݏot[̃\[X
+     * @param row_pitch s̊ԊuioCgj
+     * @param layer ǂݏoz񃌃C[iLinearȃC[Wł0j
+     * @return 擪̉f̃AhX
+     */
+    const uint8_t* GetImageData(const FrameContext& frame, vk::DeviceSize& row_pitch, const uint32_t layer = 0) const
+    {
+        if (frame.linear)
+        {
+            row_pitch = frame.linear_layout.rowPitch;
+            return static_cast<const uint8_t*>(frame.image_alloc.mapped) + frame.linear_layout.offset;
+        }
+
+        row_pitch = vk::DeviceSize(extent_.width) * 4;
+        return static_cast<const uint8_t*>(readback_pool_.Get(frame.readback_index).mapped) + row_pitch * extent_.height * layer;
+    }
+
+    /**
+     * @brief 摜GR[hăt@CɏoiGR[_[̃[J[Ăԁj
+     * @param file_name o͂t@C
+     * @param image_data 擪̉f̃AhX
+     * @param row_pitch s̊ԊuioCgj
+     */
+    void WriteImage(const std::string& file_name, const uint8_t* image_data, const vk::DeviceSize row_pitch) const
+    {
+        // PNG͍s̊Ԋuwł̂ŁÂ܂ܓnistB^ƈkIDAToĂj
+        if (options_.image_format == ImageFormat::Png)
+        {
+            stbi_write_png(file_name.c_str(), extent_.width, extent_.height, 4, image_data, static_cast<int>(row_pitch));
+            return;
+        }
+
+        const size_t packed_row_size = size_t(extent_.width) * 4;
+
+        // stbi_write_bmpstbi_write_jpg͍s̊ԊuwłȂ̂ŁA]΋lߒ
+        std::vector<uint8_t> packed_image;
+        if (row_pitch != packed_row_size)
+        {
+            packed_image.resize(packed_row_size * extent_.height);
+            for (uint32_t y = 0; y < extent_.height; y++)
+            {
+                std::memcpy(packed_image.data() + packed_row_size * y, image_data + row_pitch * y, packed_row_size);
+            }
+            image_data = packed_image.data();
+        }
+
+        if (options_.image_format == ImageFormat::Jpg)
+        {
+            stbi_write_jpg(file_name.c_str(), extent_.width, extent_.height, 4, image_data, options_.jpg_quality);
+            return;
+        }
 
-static std::string AppName = "Vulkan Test";
-static std::string EngineName = "Vulkan.hpp";
+        stbi_write_bmp(file_name.c_str(), extent_.width, extent_.height, 4, image_data);
+    }
 
-class App
-{
-public:
-    void run()
+    /**
+     * @brief _[^[Qbg̏LOtBbNX̃t@~]̃t@~ֈڂoA
+     *
+     * oAOtBbNXL[Ń[XƂāA]L[Ŏ擾ƂċL^B
+     * ̃t[̓_[pXŃNAĕ`̂ŁiinitialLayouteUndefinedjAL͖߂Ȃ
+     * @param frame gpt[̃\[X
+     * @param src_access [Xő҂ANZX
+     * @param dst_access 擾̃ANZX
+     */
+    vk::ImageMemoryBarrier GetOwnershipTransferBarrier(const FrameContext& frame, const vk::AccessFlags src_access, const vk::AccessFlags dst_access) const
     {
-        InitVulkan();
-        CleanUp();
+        vk::ImageMemoryBarrier barrier;
+        barrier.srcAccessMask = src_access;
+        barrier.dstAccessMask = dst_access;
+        barrier.oldLayout = vk::ImageLayout::eGeneral;
+        barrier.newLayout = vk::ImageLayout::eGeneral;
+        barrier.srcQueueFamilyIndex = graphics_queue_family_index_;
+        barrier.dstQueueFamilyIndex = queue_topology_.TransferFamily();
+        barrier.image = frame.image.get();
+        barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, frame.layer_count);
+        return barrier;
     }
 
-private:
-	std::vector<const char*> required_layers_ = { "VK_LAYER_KHRONOS_validation" };
+    /**
+     * @brief _[^[Qbgǂݏopobt@ւ̃Rs[ƁACPUǂނ߂̃oAL^
+     * @param cmd_buf L^̃R}hobt@
+     * @param frame gpt[̃\[X
+     * @param readback_buffer Rs[
+     */
+    void RecordReadbackCopy(const vk::CommandBuffer cmd_buf, const FrameContext& frame, const vk::Buffer readback_buffer)
+    {
+        // ]p̃t@~ł̓Rs[͈̔͂minImageTransferGranularityɐ邪ATu\[XŜ̃Rs[͏ɋB
+        // ׂĂ̔z񃌃C[1ŃRs[iobt@ɂ̓C[ɌԂȂԁj
+        cmd_buf.copyImageToBuffer(
+            frame.image.get(), 
+            vk::ImageLayout::eGeneral, 
+            readback_buffer, 
+            vk::BufferImageCopy{ 0, extent_.width, extent_.height, vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, frame.layer_count}, vk::Offset3D{0, 0, 0}, vk::Extent3D{extent_.width, extent_.height, 1} }
+        );
 
-    // VulkanCX^X
-	vk::UniqueInstance instance_;
+        // Rs[ʂ𑗐M̊҂CPUǂ߂悤ɂ
+        vk::BufferMemoryBarrier host_read_barrier;
+        host_read_barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        host_read_barrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+        host_read_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        host_read_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        host_read_barrier.buffer = readback_buffer;
+        host_read_barrier.offset = 0;
+        host_read_barrier.size = VK_WHOLE_SIZE;
+
+        cmd_buf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, nullptr, host_read_barrier, nullptr);
+    }
 
-    // ׂĂ̕foCX
-	std::vector<vk::PhysicalDevice> physical_devices_;
+    /**
+     * @brief t[̕`ƁAǂݏopobt@ւ̃Rs[L^
+     *
+     * xMĂ悢eɂit[Ƃɕς̂܂߂ȂjB
+     * t[ZJ_R}hobt@Ă΁A`惊Xg͂֋L^āiL^ς݂Ȃ炻̂܂܁js
+     * @param cmd_buf L^R}hobt@
+     * @param frame gpt[̃\[X
+     * @param readback_buffer `挋ʂ̃Rs[inullȂRs[ALinearȃ_[^[Qbĝ܂ܓǂށj
+     * @param copy_on_transfer_queue Rs[͓]L[ōsił͏L̃[X܂łL^ARs[RecordCopyCommandBufferŋL^j
+     */
+    void RecordCommandBuffer(const vk::CommandBuffer cmd_buf, FrameContext& frame, const vk::Buffer readback_buffer, const bool copy_on_transfer_queue = false)
+    {
+        cmd_buf.begin(vk::CommandBufferBeginInfo());
 
-    // Vulkangp镨foCX
-	vk::PhysicalDevice physical_device_;
+        // _[pXƃRs[̑OɃ^CX^v
+        // iNG̃ZbǵAt[M邱̃R}hobt@ōsj
+        gpu_timestamps_.Begin(cmd_buf, frame.slot);
+        gpu_timestamps_.Write(cmd_buf, frame.slot, GpuTimestampPool::kRenderBegin, vk::PipelineStageFlagBits::eTopOfPipe);
 
-    vk::PhysicalDeviceMemoryProperties physical_device_mem_props_;
+        if (frame.draws.SliceCount() > 0 && !frame.draws.Recorded())
+        {
+            RecordDrawsInParallel(record_workers_, frame.draws, frame);
+        }
 
-    // OtBbNXT|[gL[t@~Ă镨foCX݂邩
-    bool exists_suitable_physical_device_ = false;
+        // oG[VƂɁA̔z񃌃C[̃t[obt@փ_[pXs
+        for (uint32_t layer = 0; layer < frame.layer_count; layer++)
+        {
+            vk::ClearValue clear_val[1];
+            GetClearColor(layer, clear_val[0].color.float32);
+
+            vk::RenderPassBeginInfo vk_render_pass_begin;
+            vk_render_pass_begin.renderPass = renderpass_.get();
+            vk_render_pass_begin.framebuffer = frame.framebuffers[layer].get();
+            vk_render_pass_begin.renderArea = vk::Rect2D({ 0,0 }, extent_);
+            vk_render_pass_begin.clearValueCount = 1;
+            vk_render_pass_begin.pClearValues = clear_val;
+
+            // ŃTupX0Ԃ̏
+            if (frame.draws.SliceCount() > 0)
+            {
+                cmd_buf.beginRenderPass(vk_render_pass_begin, vk::SubpassContents::eSecondaryCommandBuffers);
+                cmd_buf.executeCommands(frame.draws.CommandBuffers());
+            }
+            else
+            {
+                cmd_buf.beginRenderPass(vk_render_pass_begin, vk::SubpassContents::eInline);
+                RecordDraws(cmd_buf, 0, options_.draw_count);
+            }
 
-    // OtBbNXT|[gL[t@~̃CfbNXi1j
-    uint32_t graphics_queue_family_index_;
+            cmd_buf.endRenderPass();
+        }
 
-    // _foCX
-    vk::UniqueDevice device_;
+        gpu_timestamps_.Write(cmd_buf, frame.slot, GpuTimestampPool::kRenderEnd, vk::PipelineStageFlagBits::eBottomOfPipe);
 
-    // OtBbNXL[i1j
-    vk::Queue graphics_queue_;
+        if (!readback_buffer)
+        {
+            // `挋ʂ𑗐M̊҂CPU炻̂܂ܓǂ߂悤ɂ
+            vk::ImageMemoryBarrier host_read_barrier;
+            host_read_barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+            host_read_barrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+            host_read_barrier.oldLayout = vk::ImageLayout::eGeneral;
+            host_read_barrier.newLayout = vk::ImageLayout::eGeneral;
+            host_read_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            host_read_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            host_read_barrier.image = frame.image.get();
+            host_read_barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+            cmd_buf.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eHost, {}, nullptr, nullptr, host_read_barrier);
+
+            cmd_buf.end();
+            return;
+        }
 
-    vk::UniqueCommandPool cmd_pool_;
+        if (copy_on_transfer_queue)
+        {
+            // `挋ʂ̏L]L[̃t@~փ[X
+            cmd_buf.pipelineBarrier(vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr,
+                GetOwnershipTransferBarrier(frame, vk::AccessFlagBits::eColorAttachmentWrite, {}));
 
-    std::vector<vk::UniqueCommandBuffer> cmd_bufs_;
+            cmd_buf.end();
+            return;
+        }
 
-    vk::UniqueImage image_;
-    vk::UniqueImageView image_view_;
-    // C[WKvƂ郁
-    vk::MemoryRequirements image_mem_req_;
+        RecordReadbackCopy(cmd_buf, frame, readback_buffer);
 
-    vk::UniqueDeviceMemory image_mem_;
+        gpu_timestamps_.Write(cmd_buf, frame.slot, GpuTimestampPool::kCopyEnd, vk::PipelineStageFlagBits::eBottomOfPipe);
 
-    vk::UniqueRenderPass renderpass_;
+        cmd_buf.end();
+    }
 
-    vk::UniqueFramebuffer framebuffer_;
+    /**
+     * @brief oG[V̔wiFi_[pX̃NAJ[jԂ
+     *
+     * 0Ԃ͗΂ŁAԍiނɂĐ𑫂Ă
+     * @param layer oG[V̔ԍiz񃌃C[j
+     * @param color RGBAސ
+     */
+    void GetClearColor(const uint32_t layer, float color[4]) const
+    {
+        color[0] = 0.0f;
+        color[1] = 1.0f;
+        color[2] = options_.layer_count > 1 ? static_cast<float>(layer) / static_cast<float>(options_.layer_count - 1) : 0.0f;
+        color[3] = 1.0f;
+    }
 
-    vk::UniquePipeline pipeline_;
+    /**
+     * @brief `惊Xĝ[first, first + count)̃h[R[ATupX0Ԃ̒ɋL^
+     *
+     * _Ci~bNXe[gƃpCvC̓ZJ_R}hobt@ɈpȂ̂ŁAXCXƂɐݒ肷
+     */
+    void RecordDraws(const vk::CommandBuffer cmd_buf, const uint32_t first, const uint32_t count) const
+    {
+        cmd_buf.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_.get());
 
-    vk::UniqueShaderModule vert_shader_;
-    vk::UniqueShaderModule frag_shader_;
+        cmd_buf.setViewport(0, vk::Viewport(0.0f, 0.0f, static_cast<float>(extent_.width), static_cast<float>(extent_.height), 0.0f, 1.0f));
+        cmd_buf.setScissor(0, vk::Rect2D({ 0, 0 }, extent_));
 
-    vk::UniqueBuffer buffer_;
-    vk::UniqueDeviceMemory buffer_mem_;
-    vk::MemoryRequirements buffer_mem_req_;
+        // `惊Xg̊evf̓CX^X̔ԍŋʂiVF[_[͎gȂ̂ŁAOp`d˂ĕ`j
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            cmd_buf.draw(3, 1, 0, i);
+        }
+    }
 
     /**
-     * @brief VulkanCX^X̍쐬
+     * @brief `惊XgXCXɕāÃXbhŃZJ_R}hobt@֋L^
+     * @param workers L^𕪒SXbh
+     * @param recorder L^ĩv[̓Zbgj
+     * @param frame `̃t[obt@t[
      */
-    void CreateInstance()
+    void RecordDrawsInParallel(ParallelFor& workers, SecondaryCommandRecorder& recorder, const FrameContext& frame)
     {
-        // vk::ApplicationInfõCX^X
-        const vk::ApplicationInfo application_info(AppName.c_str(), 1, EngineName.c_str(), 1, VK_API_VERSION_1_1);
-
-        // vk::InstanceCreateInfõCX^X
-        vk::InstanceCreateInfo instance_create_info({}, &application_info);
+        TRACE_SCOPE("RecordDrawsInParallel");
 
-        instance_create_info.enabledLayerCount = required_layers_.size();
-        instance_create_info.ppEnabledLayerNames = &required_layers_.front();
+        vk::CommandBufferInheritanceInfo inheritance;
+        inheritance.renderPass = renderpass_.get();
+        inheritance.subpass = 0;
+        // C[΁AZJ_R}hobt@ǂ̃C[̃t[obt@łsł悤ɂ
+        inheritance.framebuffer = frame.framebuffers.size() == 1 ? frame.framebuffers.front().get() : vk::Framebuffer();
 
-        // VulkañCX^X
-        instance_ = vk::createInstanceUnique(instance_create_info);
+        recorder.Record(workers, inheritance, options_.draw_count,
+            [this](const vk::CommandBuffer cmd_buf, const uint32_t first, const uint32_t count) { RecordDraws(cmd_buf, first, count); });
     }
 
     /**
-     * @brief foCX̎擾
+     * @brief ]L[ŎsA`挋ʂ̏L̎擾Ɠǂݏopobt@ւ̃Rs[L^
+     *
+     * RecordCommandBuffeřɋL^i^CX^v̓Xbg̃Rs[̈ʒuɏj
+     * @param cmd_buf L^R}hobt@
+     * @param frame gpt[̃\[X
+     * @param readback_buffer `挋ʂ̃Rs[
      */
-    void GetPhysicalDevices()
+    void RecordCopyCommandBuffer(const vk::CommandBuffer cmd_buf, const FrameContext& frame, const vk::Buffer readback_buffer)
     {
-        // foCX̎擾
-        physical_devices_ = instance_->enumeratePhysicalDevices();
+        cmd_buf.begin(vk::CommandBufferBeginInfo());
+
+        // OtBbNXL[[XL擾iZ}tH̑҂ƓeTransfern߂āAˑqj
+        cmd_buf.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr,
+            GetOwnershipTransferBarrier(frame, {}, vk::AccessFlagBits::eTransferRead));
+
+        // Rs[̑OɃ^CX^vi]̃t@~ΉĂ΁j
+        const bool timestamps = queue_topology_.TransferSupportsTimestamps();
+        if (timestamps)
+        {
+            gpu_timestamps_.Write(cmd_buf, frame.slot, GpuTimestampPool::kCopyBegin, vk::PipelineStageFlagBits::eTopOfPipe);
+        }
+
+        RecordReadbackCopy(cmd_buf, frame, readback_buffer);
+
+        if (timestamps)
+        {
+            gpu_timestamps_.Write(cmd_buf, frame.slot, GpuTimestampPool::kCopyEnd, vk::PipelineStageFlagBits::eBottomOfPipe);
+        }
+
+        cmd_buf.end();
     }
 
     /**
-     * @brief foCXׂ̂ẴL[t@~̏\
+     * @brief t[̃R}hL^GPU֑Mi͑҂Ȃj
+     * @param frame gpt[̃\[X
+     * @param frame_index t[ԍ
      */
-    void PrintPhysicalDevices() const
+    void SubmitFrame(FrameContext& frame, const uint32_t frame_index)
     {
-        VkPhysicalDeviceProperties physical_device_properties;
-        for (size_t i = 0; i < physical_devices_.size(); i++)
-        {
-            physical_device_properties = physical_devices_[i].getProperties();
-            std::cout << physical_device_properties.deviceName << std::endl;
+        TRACE_SCOPE("SubmitFrame", "frame", frame_index);
 
-            std::vector<vk::QueueFamilyProperties> queueProps = physical_devices_[i].getQueueFamilyProperties();
+        frame.frame_index = frame_index;
+        frame.submit_time = std::chrono::steady_clock::now();
 
-            // foCXׂ̂ẴL[t@~̏\
-            std::cout << "queue family count: " << queueProps.size() << std::endl;
-            std::cout << std::endl;
-            for (size_t i = 0; i < queueProps.size(); i++)
+        // L^ς݂̃R}hobt@΋L^ɑMB
+        // L^e͓ǂݏõobt@Ō܂̂ŁÃCfbNXL[ɂiLinearȂǂݏo͂Ȃj
+        vk::CommandBuffer cmd_buf;
+        vk::CommandBuffer copy_cmd_buf;
+        if (frame.linear)
+        {
+            TRACE_SCOPE("RecordCommandBuffer");
+            cmd_buf = frame.commands.Get(0, [&](const vk::CommandBuffer cb) { RecordCommandBuffer(cb, frame, nullptr); }, frame.cmd_buf_reused);
+        }
+        else
+        {
+            // ǂݏõobt@؂
             {
-                std::cout << "queue family index: " << i << std::endl;
-                std::cout << "  queue count: " << queueProps[i].queueCount << std::endl;
-                std::cout << "  graphic support: " << (queueProps[i].queueFlags & vk::QueueFlagBits::eGraphics ? "True" : "False") << std::endl;
-                std::cout << "  compute support: " << (queueProps[i].queueFlags & vk::QueueFlagBits::eCompute ? "True" : "False") << std::endl;
-                std::cout << "  transfer support: " << (queueProps[i].queueFlags & vk::QueueFlagBits::eTransfer ? "True" : "False") << std::endl;
-                std::cout << std::endl;
+                TRACE_SCOPE("AcquireReadbackBuffer");
+                frame.readback_index = readback_pool_.Acquire();
+            }
+
+            TRACE_SCOPE("RecordCommandBuffer");
+            const vk::Buffer readback_buffer = readback_pool_.Get(frame.readback_index).buffer.get();
+            if (copy_on_transfer_queue_)
+            {
+                // `摤͓ǂݏo܂܂Ȃ̂1ő
+                bool copy_reused = false;
+                cmd_buf = frame.commands.Get(0, [&](const vk::CommandBuffer cb) { RecordCommandBuffer(cb, frame, readback_buffer, true); }, frame.cmd_buf_reused);
+                copy_cmd_buf = frame.copy_commands.Get(frame.readback_index, [&](const vk::CommandBuffer cb) { RecordCopyCommandBuffer(cb, frame, readback_buffer); }, copy_reused);
+                frame.cmd_buf_reused = frame.cmd_buf_reused && copy_reused;
+            }
+            else
+            {
+                cmd_buf = frame.commands.Get(frame.readback_index, [&](const vk::CommandBuffer cb) { RecordCommandBuffer(cb, frame, readback_buffer); }, frame.cmd_buf_reused);
             }
         }
+
+        const vk::CommandBuffer submit_cmd_buf[1] = { cmd_buf };
+        vk::SubmitInfo submitInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = submit_cmd_buf;
+
+        if (frame.linear || !copy_on_transfer_queue_)
+        {
+            TRACE_SCOPE("QueueSubmit");
+            frame.timeline = &graphics_timeline_;
+            frame.timeline_value = graphics_timeline_.Submit(submitInfo);
+        }
+        else
+        {
+            // `̊Z}tHœ]L[֓`At[̊̓Rs[̑MŒǐՂB
+            // ]L[̃t[Rs[ĂԂɁAOtBbNXL[͎̃t[`ł
+            const vk::Semaphore render_done[1] = { frame.render_done.get() };
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = render_done;
+
+            const vk::CommandBuffer submit_copy_cmd_buf[1] = { copy_cmd_buf };
+            const vk::PipelineStageFlags wait_stages[1] = { vk::PipelineStageFlagBits::eTransfer };
+            vk::SubmitInfo copy_submit_info;
+            copy_submit_info.waitSemaphoreCount = 1;
+            copy_submit_info.pWaitSemaphores = render_done;
+            copy_submit_info.pWaitDstStageMask = wait_stages;
+            copy_submit_info.commandBufferCount = 1;
+            copy_submit_info.pCommandBuffers = submit_copy_cmd_buf;
+
+            TRACE_SCOPE("QueueSubmit");
+            graphics_queue_.submit({ submitInfo }, nullptr);
+            frame.timeline = &transfer_timeline_;
+            frame.timeline_value = transfer_timeline_.Submit(copy_submit_info);
+        }
+
+        frame.pending = true;
     }
 
     /**
-     * @brief OtBbNXT|[gL[t@~Œł1Ă镨foCXI
+     * @brief t[̊҂Aǂݏo摜o
+     * @param frame Mς݂̃t[̃\[X
      */
-    void SelectPhysicalDevice()
+    void FinishFrame(FrameContext& frame)
     {
-        for (size_t i = 0; i < physical_devices_.size(); i++)
+        TRACE_SCOPE("FinishFrame", "frame", frame.frame_index);
+
         {
-            std::vector<vk::QueueFamilyProperties> queueProps = physical_devices_[i].getQueueFamilyProperties();
-            bool existsGraphicsQueue = false;
+            // ̃t[̑M҂iォ瑗Mt[GPUŏ𑱂j
+            TRACE_SCOPE("WaitForGpu");
+            frame.timeline->Wait(frame.timeline_value);
+        }
+
+        FrameRecord record;
+        record.frame_index = frame.frame_index;
+        record.cmd_buf_reused = frame.cmd_buf_reused;
 
-            for (size_t j = 0; j < queueProps.size(); j++)
+        // _[pXƃRs[GPUԁi]L[ŃRs[ꍇARs[̎Ԃ̓L[̊Ԃ̎󂯓n܂܂Ȃj
+        const GpuTimestampPool::Durations gpu_durations = gpu_timestamps_.Read(frame.slot);
+        record.gpu_render_ms = gpu_durations.render_ms;
+        record.gpu_copy_ms = gpu_durations.copy_ms;
+
+        const std::string file_name = GetOutputFileName(frame.frame_index);
+        const auto submit_time = frame.submit_time;
+        const bool linear = frame.linear;
+
+        if (linear)
+        {
+            // Rq[głȂCPŨLbV𖳌Ăǂ
+            allocator_.Invalidate(frame.image_alloc);
+
+            // _[^[Qbg͂̃t[ŎĝŁAfl߂CPŨ֎ʂĂGR[_[֓n
+            const size_t packed_row_size = size_t(extent_.width) * 4;
+            auto pixels = std::make_shared<std::vector<uint8_t>>(packed_row_size * extent_.height);
             {
-                if (queueProps[j].queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eTransfer))
+                TRACE_SCOPE("CopyLinearImage");
+
+                vk::DeviceSize row_pitch;
+                const uint8_t* image_data = GetImageData(frame, row_pitch);
+                for (uint32_t y = 0; y < extent_.height; y++)
                 {
-                    existsGraphicsQueue = true;
-                    graphics_queue_family_index_ = j;
-                    break;
+                    std::memcpy(pixels->data() + packed_row_size * y, image_data + row_pitch * y, packed_row_size);
                 }
             }
 
-            if (existsGraphicsQueue)
+            encoder_pool_.Submit([this, record, file_name, submit_time, pixels, packed_row_size]() mutable
             {
-                physical_device_ = physical_devices_[i];
-                exists_suitable_physical_device_ = true;
-                break;
-            }
+                const auto encode_begin = std::chrono::steady_clock::now();
+                {
+                    TRACE_SCOPE("EncodeImage", "frame", record.frame_index);
+                    WriteImage(file_name, pixels->data(), packed_row_size);
+                }
+                CompleteFrameRecord(record, submit_time, encode_begin, true);
+            });
         }
-
-        if (!exists_suitable_physical_device_)
+        else
         {
-            std::cerr << "gp\ȕfoCX܂" << std::endl;
-            throw std::runtime_error("gp\ȕfoCX܂");
+            // Rq[głȂCPŨLbV𖳌Ăǂ
+            readback_pool_.Invalidate(frame.readback_index);
+
+            // ǂݏopobt@̓GR[hI܂ŃGR[_[؂ĂB
+            // oG[V͕ʁX̃^XNŏoAŌɏI^XNobt@Ԃ
+            const uint32_t readback_index = frame.readback_index;
+            const auto remaining_layers = std::make_shared<std::atomic<uint32_t>>(frame.layer_count);
+
+            for (uint32_t layer = 0; layer < frame.layer_count; layer++)
+            {
+                record.layer = layer;
+                const std::string layer_file_name = GetOutputFileName(frame.frame_index, layer);
+
+                encoder_pool_.Submit([this, record, layer_file_name, submit_time, readback_index, layer, remaining_layers]() mutable
+                {
+                    const auto encode_begin = std::chrono::steady_clock::now();
+                    {
+                        // o𔲂AŌ̃oG[VȂobt@ԂB
+                        // OŔꍇԂȂƁA`惋[vAcquireő҂ėO󂯎Ȃ
+                        struct LayerRelease
+                        {
+                            ReadbackBufferPool& pool;
+                            uint32_t index;
+                            std::atomic<uint32_t>& remaining_layers;
+
+                            ~LayerRelease()
+                            {
+                                if (--remaining_layers == 0)
+                                {
+                                    pool.Release(index);
+                                }
+                            }
+                        } layer_release{ readback_pool_, readback_index, *remaining_layers };
+
+                        TRACE_SCOPE("EncodeImage", "frame", record.frame_index);
+                        const vk::DeviceSize row_pitch = vk::DeviceSize(extent_.width) * 4;
+                        const uint8_t* image_data = static_cast<const uint8_t*>(readback_pool_.Get(readback_index).mapped) + row_pitch * extent_.height * layer;
+                        WriteImage(layer_file_name, image_data, row_pitch);
+                    }
+
+                    CompleteFrameRecord(record, submit_time, encode_begin, false);
+                });
+            }
         }
 
-        std::cout << "gpfoCX:" << physical_device_.getProperties().deviceName << std::endl;
+        frame.pending = false;
+    }
 
-        // foCX̃
-        physical_device_mem_props_ = physical_device_.getMemoryProperties();
+    /**
+     * @brief GR[hIt[̌vʂL^iGR[_[̃[J[Ăԁj
+     * @param record GPUԂ܂ŋLv
+     * @param submit_time t[𑗐M
+     * @param encode_begin GR[hn߂
+     * @param linear Linearȃ_[^[Qbgǂ񂾂
+     */
+    void CompleteFrameRecord(FrameRecord& record, const std::chrono::steady_clock::time_point submit_time, const std::chrono::steady_clock::time_point encode_begin, const bool linear)
+    {
+        const auto end = std::chrono::steady_clock::now();
+        record.encode_ms = std::chrono::duration<double, std::milli>(end - encode_begin).count();
+        record.latency_ms = std::chrono::duration<double, std::milli>(end - submit_time).count();
+
+        std::lock_guard<std::mutex> lock(records_mutex_);
+        WriteFrameRecord(record, linear);
+        frame_records_.push_back(record);
     }
 
     /**
-     * @brief _foCX̍쐬ƃL[̎擾
+     * @brief frame_count̃t[`悵ďo
+     *
+     * őframes_in_flight̃t[GPU֓ĂA
+     * GPUVt[`悵ĂԂɁAÕt[ǂݏoďo
      */
-    void CreateLogicalDevice()
+    void RenderFrames()
     {
-        vk::DeviceCreateInfo device_create_info;
+        const uint32_t frames_in_flight = static_cast<uint32_t>(frames_.size());
 
-        // _foCXɃL[̎gp`
-        vk::DeviceQueueCreateInfo queue_create_info[1];
-        queue_create_info[0].queueFamilyIndex = graphics_queue_family_index_;
-        queue_create_info[0].queueCount = 1;
-        const float queue_priorities[1] = { 1.0f };
-        queue_create_info[0].pQueuePriorities = queue_priorities;
+        frame_records_.clear();
+        frame_records_.reserve(size_t(options_.frame_count) * options_.layer_count);
 
-        device_create_info.pQueueCreateInfos = queue_create_info;
-        device_create_info.queueCreateInfoCount = 1;
+        const uint64_t submit_stalls_before = encoder_pool_.SubmitStalls();
 
-        // of[VC[
-        device_create_info.enabledLayerCount = required_layers_.size();
-        device_create_info.ppEnabledLayerNames = &required_layers_.front();
+        uint64_t records_before = 0;
+        uint64_t reuses_before = 0;
+        CountCommandBuffers(records_before, reuses_before);
 
-        // _foCX̍쐬
-        device_ = physical_device_.createDeviceUnique(device_create_info);
+        const auto begin = std::chrono::steady_clock::now();
 
-        // L[̎擾
-        graphics_queue_ = device_->getQueue(graphics_queue_family_index_, 0);
+        // ɏot[ԍit[͑Mɏoj
+        uint32_t next_finish_index = 0;
+
+        for (uint32_t frame_index = 0; frame_index < options_.frame_count; frame_index++)
+        {
+            // O̓ʒugframes_in_flightÕt[܂ȂÅ҂ďo
+            FrameContext& frame = frames_[frame_index % frames_in_flight];
+            if (frame.pending)
+            {
+                FinishFrame(frame);
+                next_finish_index++;
+            }
+
+            SubmitFrame(frame, frame_index);
+
+            // GPUIt[́AÔ҂ɏoi𒲂ׂ邾ő҂Ȃj
+            while (next_finish_index <= frame_index)
+            {
+                FrameContext& oldest = frames_[next_finish_index % frames_in_flight];
+                if (!oldest.timeline->IsComplete(oldest.timeline_value))
+                {
+                    break;
+                }
+                FinishFrame(oldest);
+                next_finish_index++;
+            }
+        }
+
+        // c̃t[𑗐Mɏo
+        for (; next_finish_index < options_.frame_count; next_finish_index++)
+        {
+            FinishFrame(frames_[next_finish_index % frames_in_flight]);
+        }
+
+        // GR[_[ɎcĂt[̏o҂
+        {
+            TRACE_SCOPE("WaitForEncoder");
+            encoder_pool_.WaitIdle();
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+
+        uint64_t records = 0;
+        uint64_t reuses = 0;
+        CountCommandBuffers(records, reuses);
+
+        PrintFrameStatistics(std::chrono::duration<double>(end - begin).count(), encoder_pool_.SubmitStalls() - submit_stalls_before,
+            records - records_before, reuses - reuses_before);
     }
 
-    void CreateCommandPool()
+    /**
+     * @brief ׂẴt[ŃR}hobt@L^񐔂ƁAL^ɑM񐔂̍v
+     */
+    void CountCommandBuffers(uint64_t& records, uint64_t& reuses) const
     {
-        vk::CommandPoolCreateInfo cmd_pool_create_info;
+        records = 0;
+        reuses = 0;
+        for (const FrameContext& frame : frames_)
+        {
+            records += frame.commands.Records() + frame.copy_commands.Records();
+            reuses += frame.commands.Reuses() + frame.copy_commands.Reuses();
+        }
+    }
 
-        // ł̃R}hobt@𑗐MƂɑΏۂƂL[
-        cmd_pool_create_info.queueFamilyIndex = graphics_queue_family_index_;
+    /**
+     * @brief t[[gƃt[Ƃ̃CeV\
+     * @param elapsed_sec St[̕`ɂ
+     * @param submit_stalls GR[_[̃L[ςŕ`惋[v҂ꂽ
+     * @param cmd_buf_records R}hobt@L^
+     * @param cmd_buf_reuses L^ς݂̃R}hobt@𑗐M
+     */
+    void PrintFrameStatistics(const double elapsed_sec, const uint64_t submit_stalls, const uint64_t cmd_buf_records, const uint64_t cmd_buf_reuses) const
+    {
+        double latency_sum_ms = 0.0;
+        double encode_sum_ms = 0.0;
+        double gpu_render_sum_ms = 0.0;
+        double gpu_copy_sum_ms = 0.0;
+        uint32_t gpu_render_count = 0;
+        uint32_t gpu_copy_count = 0;
+
+        for (const FrameRecord& record : frame_records_)
+        {
+            latency_sum_ms += record.latency_ms;
+            encode_sum_ms += record.encode_ms;
 
-        cmd_pool_ = device_->createCommandPoolUnique(cmd_pool_create_info);
+            if (record.gpu_render_ms >= 0.0)
+            {
+                gpu_render_sum_ms += record.gpu_render_ms;
+                gpu_render_count++;
+            }
+            if (record.gpu_copy_ms >= 0.0)
+            {
+                gpu_copy_sum_ms += record.gpu_copy_ms;
+                gpu_copy_count++;
+            }
+        }
+
+        const auto [min_record, max_record] = std::minmax_element(frame_records_.begin(), frame_records_.end(),
+            [](const FrameRecord& a, const FrameRecord& b) { return a.latency_ms < b.latency_ms; });
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "frames: " << options_.frame_count << " at " << extent_.width << "x" << extent_.height << " (in flight: " << frames_.size() << ")" << std::endl;
+        std::cout << "  elapsed: " << elapsed_sec * 1000.0 << " ms" << std::endl;
+        std::cout << "  fps: " << options_.frame_count / elapsed_sec << std::endl;
+        if (options_.layer_count > 1)
+        {
+            std::cout << "  images: " << frame_records_.size() << " (" << options_.layer_count << " layers per frame), "
+                << frame_records_.size() / elapsed_sec << " per second" << std::endl;
+        }
+        std::cout << "  latency avg/min/max: "
+            << latency_sum_ms / frame_records_.size() << " / "
+            << min_record->latency_ms << " / "
+            << max_record->latency_ms << " ms" << std::endl;
+        std::cout << "  cpu encode avg: " << encode_sum_ms / frame_records_.size() << " ms"
+            << " (" << encoder_pool_.ThreadCount() << " threads, queue depth " << encoder_pool_.QueueDepth() << ", " << submit_stalls << " stalls)" << std::endl;
+        std::cout << "  command buffers: " << cmd_buf_records << " recorded, " << cmd_buf_reuses << " reused" << std::endl;
+        if (gpu_render_count > 0)
+        {
+            std::cout << "  gpu render avg: " << gpu_render_sum_ms / gpu_render_count << " ms" << std::endl;
+        }
+        if (gpu_copy_count > 0)
+        {
+            std::cout << "  gpu copy avg: " << gpu_copy_sum_ms / gpu_copy_count << " ms" << std::endl;
+        }
+        std::cout.unsetf(std::ios_base::floatfield);
     }
 
-    void CreateCommandBuffers()
+    /**
+     * @brief t[̌vʂJSON1sƂďo
+     *
+     * vłȂlnullɂ
+     * @param record v
+     * @param linear Linearȃ_[^[Qbgǂ񂾂
+     */
+    void WriteFrameRecord(const FrameRecord& record, const bool linear)
     {
-        vk::CommandBufferAllocateInfo vk_cmd_buf_alloc_info;
-        vk_cmd_buf_alloc_info.commandPool = cmd_pool_.get();
-        vk_cmd_buf_alloc_info.commandBufferCount = 1; // R}hobt@̐
-        vk_cmd_buf_alloc_info.level = vk::CommandBufferLevel::ePrimary;
-        
-        cmd_bufs_ = device_->allocateCommandBuffersUnique(vk_cmd_buf_alloc_info);
+        if (!stats_json_.is_open())
+        {
+            return;
+        }
+
+        const auto number_or_null = [](const double value)
+        {
+            if (value < 0.0)
+            {
+                return std::string("null");
+            }
+
+            char text[32];
+            std::snprintf(text, sizeof(text), "%.4f", value);
+            return std::string(text);
+        };
+
+        stats_json_
+            << "{\"job\":" << job_index_
+            << ",\"frame\":" << record.frame_index
+            << ",\"layer\":" << record.layer
+            << ",\"width\":" << extent_.width
+            << ",\"height\":" << extent_.height
+            << ",\"format\":\"" << vk::to_string(format_) << "\""
+            << ",\"readback\":\"" << (linear ? "linear" : "copy") << "\""
+            << ",\"gpu_render_ms\":" << number_or_null(record.gpu_render_ms)
+            << ",\"gpu_copy_ms\":" << number_or_null(record.gpu_copy_ms)
+            << ",\"cpu_encode_ms\":" << number_or_null(record.encode_ms)
+            << ",\"latency_ms\":" << number_or_null(record.latency_ms)
+            << ",\"cmd_buf_reused\":" << (record.cmd_buf_reused ? "true" : "false")
+            << "}\n";
+
+        // _bV{[hro߂ǂ߂悤ɁA1sƂɏo
+        stats_json_.flush();
     }
 
     /**
-     * @brief 摜obt@̗v郁^CvƎgp@\gCfbNXԂ
-     * @param request_type_filter v郁^Cv
-     * @param properties ̋@\
-     * @return ̃CfbNX
+     * @brief obt@Ɋ蓖ĉ\HostVisibleȃ^CvƂɁACPU̓ǂݏoшv
      */
-    uint32_t FindMemoryType(const uint32_t request_type_filter, const vk::MemoryPropertyFlagBits properties) const
+    void BenchmarkReadback()
     {
-	    const vk::PhysicalDeviceMemoryProperties physical_device_memory_properties = physical_device_.getMemoryProperties();
+        constexpr int kIterations = 5;
 
-        for (uint32_t i = 0; i < physical_device_memory_properties.memoryTypeCount; i++) {
-            if ((request_type_filter & (1 << i)) && (physical_device_memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
+        // ob`Ȃ炷ׂẴC[󂯎傫ɂ
+        const vk::DeviceSize buffer_size = vk::DeviceSize(extent_.width) * extent_.height * 4 * frames_.front().layer_count;
+        std::vector<uint8_t> host_copy(buffer_size);
+
+        FrameContext& frame = frames_.front();
+
+        // v̂тɋL^̂ŁAt[̃LbVƂ͕ʂ̃R}hobt@g
+        vk::CommandBufferAllocateInfo cmd_buf_alloc_info;
+        cmd_buf_alloc_info.commandPool = cmd_pool_.get();
+        cmd_buf_alloc_info.commandBufferCount = 1;
+        cmd_buf_alloc_info.level = vk::CommandBufferLevel::ePrimary;
+        const vk::UniqueCommandBuffer cmd_buf = std::move(device_->allocateCommandBuffersUnique(cmd_buf_alloc_info).front());
+
+        vk::BufferCreateInfo buffer_create_info;
+        buffer_create_info.size = buffer_size;
+        buffer_create_info.usage = vk::BufferUsageFlagBits::eTransferDst;
+
+        std::cout << "readback bandwidth (" << buffer_size / (1024 * 1024) << " MiB, best of " << kIterations << "):" << std::endl;
+
+        for (uint32_t i = 0; i < physical_device_mem_props_.memoryTypeCount; i++)
+        {
+            const vk::MemoryPropertyFlags properties = physical_device_mem_props_.memoryTypes[i].propertyFlags;
+            if (!(properties & vk::MemoryPropertyFlagBits::eHostVisible))
+            {
+                continue;
+            }
+
+            vk::UniqueBuffer buffer = device_->createBufferUnique(buffer_create_info);
+            const vk::MemoryRequirements mem_req = device_->getBufferMemoryRequirements(buffer.get());
+            if (!(mem_req.memoryTypeBits & (1u << i)))
+            {
+                continue;
+            }
+
+            vk::UniqueDeviceMemory memory = device_->allocateMemoryUnique(vk::MemoryAllocateInfo(mem_req.size, i));
+            device_->bindBufferMemory(buffer.get(), memory.get(), 0);
+            const void* mapped = device_->mapMemory(memory.get(), 0, VK_WHOLE_SIZE);
+
+            // ۂ̕`挋ʂRs[Ăǂ
+            RecordCommandBuffer(cmd_buf.get(), frame, buffer.get());
+
+            const vk::CommandBuffer submit_cmd_buf[1] = { cmd_buf.get() };
+            vk::SubmitInfo submitInfo;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = submit_cmd_buf;
+
+            graphics_timeline_.Wait(graphics_timeline_.Submit(submitInfo));
+
+            double best_sec = 0.0;
+            for (int iteration = 0; iteration < kIterations; iteration++)
+            {
+                const auto begin = std::chrono::steady_clock::now();
+
+                if (!(properties & vk::MemoryPropertyFlagBits::eHostCoherent))
+                {
+                    device_->invalidateMappedMemoryRanges(vk::MappedMemoryRange(memory.get(), 0, VK_WHOLE_SIZE));
+                }
+                std::memcpy(host_copy.data(), mapped, buffer_size);
+
+                const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                if (iteration == 0 || sec < best_sec)
+                {
+                    best_sec = sec;
+                }
             }
-        }
 
-        throw std::runtime_error("Failed to find suitable memory type!");
+            std::cout << "  type " << i << " " << vk::to_string(properties)
+                << " (heap " << physical_device_mem_props_.memoryTypes[i].heapIndex << "): "
+                << std::fixed << std::setprecision(2) << buffer_size / best_sec / 1e9 << " GB/s" << std::endl;
+            std::cout.unsetf(std::ios_base::floatfield);
+        }
     }
 
-    void CreateImage()
+    /**
+     * @brief `悵ĂCPŨ֓ǂݍނ܂ł̎ԂARs[ꍇLinearȃ_[^[QbgǂޏꍇŔr
+     *
+     * 𑜓xcopyImageToBuffeřŒ̃RXgxzIɂȂA
+     * 傫LinearȃC[Wւ̕`̒xڗ̂ŁAǂ炪̓foCXƉ𑜓xɂ
+     */
+    void BenchmarkRenderTargets()
     {
-        const vk::Format image_format = vk::Format::eR8G8B8A8Unorm;
-        const vk::FormatProperties format_properties = physical_device_.getFormatProperties(image_format);
+        constexpr int kIterations = 10;
 
-        const vk::ImageTiling image_tiling = vk::ImageTiling::eOptimal;
-        if (format_properties.linearTilingFeatures & vk::FormatFeatureFlagBits::eColorAttachment)
-        {
-            std::cout << "LinearɑΉ" << std::endl;
-        }
-        else if (format_properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eColorAttachment)
-        {
-            std::cout << "LinearɔΉ" << std::endl;
-        }
+        const size_t packed_row_size = size_t(extent_.width) * 4;
+        std::vector<uint8_t> host_copy(packed_row_size * extent_.height * options_.layer_count);
 
-        /* C[W̍쐬 */
+        // LinearȃC[W͔z񃌃C[ĂȂ̂ŁAob`łׂ͔Ȃ
+        const bool linear_supported = options_.layer_count == 1 && (linear_render_target_ || ProbeLinearRenderTarget());
 
-        vk::ImageCreateInfo image_create_info;
-        image_create_info.imageType = vk::ImageType::e2D;
-        image_create_info.extent = vk::Extent3D(kScreenWidth, kScreenHeight, 1);
-        image_create_info.mipLevels = 1;
-        image_create_info.arrayLayers = 1;
-        image_create_info.format = image_format;
-        image_create_info.tiling = image_tiling;
-        image_create_info.initialLayout = vk::ImageLayout::eUndefined;
-        image_create_info.usage = vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment;
-    	image_create_info.sharingMode = vk::SharingMode::eExclusive;
-        image_create_info.samples = vk::SampleCountFlagBits::e1;
-        
-        image_ = device_->createImageUnique(image_create_info);
+        vk::CommandBufferAllocateInfo cmd_buf_alloc_info;
+        cmd_buf_alloc_info.commandPool = cmd_pool_.get();
+        cmd_buf_alloc_info.commandBufferCount = 1;
+        cmd_buf_alloc_info.level = vk::CommandBufferLevel::ePrimary;
 
-        /* C[W̃m */
+        std::cout << "render to host memory (" << extent_.width << "x" << extent_.height << ", best of " << kIterations << "):" << std::endl;
 
-        image_mem_req_ = device_->getImageMemoryRequirements(image_.get());
-        
-        vk::MemoryAllocateInfo image_mem_alloc_info_;
-    	image_mem_alloc_info_.allocationSize = image_mem_req_.size;
-        image_mem_alloc_info_.memoryTypeIndex = FindMemoryType(image_mem_req_.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
-        
-        image_mem_ = device_->allocateMemoryUnique(image_mem_alloc_info_);
-        
-    	device_->bindImageMemory(image_.get(), image_mem_.get(), 0);
+        for (const bool linear : { false, true })
+        {
+            const char* name = linear ? "linear" : "copy";
+            if (linear && !linear_supported)
+            {
+                std::cout << "  " << name << ": not supported" << std::endl;
+                continue;
+            }
 
-        /* obt@̍쐬 */
+            FrameContext frame;
+            frame.linear = linear;
+            const vk::UniqueCommandBuffer cmd_buf = std::move(device_->allocateCommandBuffersUnique(cmd_buf_alloc_info).front());
+            if (options_.record_threads > 1)
+            {
+                frame.draws.Init(device_.get(), graphics_queue_family_index_, options_.record_threads);
+            }
+            CreateImage(frame);
+            CreateImageView(frame);
+            CreateFrameBuffer(frame);
 
-        vk::BufferCreateInfo buffer_create_info;
-        buffer_create_info.size = image_mem_req_.size;
-        buffer_create_info.usage = vk::BufferUsageFlagBits::eTransferDst;
+            // ǂݏo[hɊ֌WȂÃׂ^COōĂ邩
+            const vk::ImageTiling expected_tiling = linear ? vk::ImageTiling::eLinear : vk::ImageTiling::eOptimal;
+            if (frame.tiling != expected_tiling)
+            {
+                throw std::logic_error("Render target was not created with the tiling being benchmarked!");
+            }
+
+            double best_ms = 0.0;
+            for (int iteration = 0; iteration < kIterations; iteration++)
+            {
+                const auto begin = std::chrono::steady_clock::now();
 
-        buffer_ = device_->createBufferUnique(buffer_create_info);
+                if (linear)
+                {
+                    RecordCommandBuffer(cmd_buf.get(), frame, nullptr);
+                }
+                else
+                {
+                    frame.readback_index = readback_pool_.Acquire();
+                    RecordCommandBuffer(cmd_buf.get(), frame, readback_pool_.Get(frame.readback_index).buffer.get());
+                }
 
-        /* obt@̃m */
+                const vk::CommandBuffer submit_cmd_buf[1] = { cmd_buf.get() };
+                vk::SubmitInfo submitInfo;
+                submitInfo.commandBufferCount = 1;
+                submitInfo.pCommandBuffers = submit_cmd_buf;
 
-        buffer_mem_req_ = device_->getBufferMemoryRequirements(buffer_.get());
+                graphics_timeline_.Wait(graphics_timeline_.Submit(submitInfo));
 
-        vk::MemoryAllocateInfo buffer_allocate_info;
-        buffer_allocate_info.allocationSize = buffer_mem_req_.size;
-        buffer_allocate_info.memoryTypeIndex = FindMemoryType(buffer_mem_req_.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible);
+                if (linear)
+                {
+                    allocator_.Invalidate(frame.image_alloc);
+                }
+                else
+                {
+                    readback_pool_.Invalidate(frame.readback_index);
+                }
 
-        buffer_mem_ = device_->allocateMemoryUnique(buffer_allocate_info);
+                for (uint32_t layer = 0; layer < frame.layer_count; layer++)
+                {
+                    vk::DeviceSize row_pitch;
+                    const uint8_t* image_data = GetImageData(frame, row_pitch, layer);
+                    uint8_t* layer_copy = host_copy.data() + packed_row_size * extent_.height * layer;
+                    for (uint32_t y = 0; y < extent_.height; y++)
+                    {
+                        std::memcpy(layer_copy + packed_row_size * y, image_data + row_pitch * y, packed_row_size);
+                    }
+                }
 
-        device_->bindBufferMemory(buffer_.get(), buffer_mem_.get(), 0);
-    }
+                if (!linear)
+                {
+                    readback_pool_.Release(frame.readback_index);
+                }
 
-    void CreateImageView()
-    {
-        vk::ImageViewCreateInfo image_view_create_info;
-        image_view_create_info.image = image_.get();
-        image_view_create_info.viewType = vk::ImageViewType::e2D;
-        image_view_create_info.format = vk::Format::eR8G8B8A8Unorm;
-        image_view_create_info.components.r = vk::ComponentSwizzle::eIdentity;
-        image_view_create_info.components.g = vk::ComponentSwizzle::eIdentity;
-        image_view_create_info.components.b = vk::ComponentSwizzle::eIdentity;
-        image_view_create_info.components.a = vk::ComponentSwizzle::eIdentity;
-        image_view_create_info.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        image_view_create_info.subresourceRange.baseMipLevel = 0;
-        image_view_create_info.subresourceRange.levelCount = 1;
-        image_view_create_info.subresourceRange.baseArrayLayer = 0;
-        image_view_create_info.subresourceRange.layerCount = 1;
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                if (iteration == 0 || ms < best_ms)
+                {
+                    best_ms = ms;
+                }
+            }
 
-        image_view_ = device_->createImageViewUnique(image_view_create_info);
+            std::cout << "  " << name << " (" << (frame.tiling == vk::ImageTiling::eLinear ? "linear" : "optimal") << " tiling): "
+                << std::fixed << std::setprecision(3) << best_ms << " ms" << std::endl;
+            std::cout.unsetf(std::ios_base::floatfield);
 
-        
+            DestroyRenderTarget(frame);
+        }
     }
 
-    void CreateRenderPass()
+    /**
+     * @brief `惊XgZJ_R}hobt@֋L^鎞ԂAXbhƂɔr
+     *
+     * L^CPȔȂ̂őM͂ȂBXbh1{Arecord_threadsi1Ȃn[hEFÃXbhj܂ő₷
+     */
+    void BenchmarkRecording()
     {
-        vk::AttachmentDescription attachments[1];
-        attachments[0].format = vk::Format::eR8G8B8A8Unorm;
-        attachments[0].samples = vk::SampleCountFlagBits::e1;
-        attachments[0].loadOp = vk::AttachmentLoadOp::eClear;
-        attachments[0].storeOp = vk::AttachmentStoreOp::eStore;
-        attachments[0].stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
-        attachments[0].stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
-        attachments[0].initialLayout = vk::ImageLayout::eUndefined;
-        attachments[0].finalLayout = vk::ImageLayout::eGeneral;
+        constexpr int kIterations = 10;
 
-        vk::AttachmentReference subpass0_attachmentRefs[1];
-        subpass0_attachmentRefs[0].attachment = 0;
-        subpass0_attachmentRefs[0].layout = vk::ImageLayout::eColorAttachmentOptimal;
+        const uint32_t max_threads = options_.record_threads > 1 ? options_.record_threads : std::max(1u, std::thread::hardware_concurrency());
 
-        vk::SubpassDescription subpasses[1];
-        subpasses[0].pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
-        subpasses[0].colorAttachmentCount = 1;
-        subpasses[0].pColorAttachments = subpass0_attachmentRefs;
+        std::vector<uint32_t> thread_counts;
+        for (uint32_t threads = 1; threads < max_threads; threads *= 2)
+        {
+            thread_counts.push_back(threads);
+        }
+        thread_counts.push_back(max_threads);
 
-        vk::RenderPassCreateInfo renderpass_create_info;
-        renderpass_create_info.attachmentCount = 1;
-        renderpass_create_info.pAttachments = attachments;
-        renderpass_create_info.subpassCount = 1;
-        renderpass_create_info.pSubpasses = subpasses;
-        renderpass_create_info.dependencyCount = 0;
-        renderpass_create_info.pDependencies = nullptr;
+        std::cout << "record " << options_.draw_count << " draws (best of " << kIterations << "):" << std::endl;
 
-        renderpass_ = device_->createRenderPassUnique(renderpass_create_info);
-    }
+        double single_thread_ms = 0.0;
+        for (const uint32_t threads : thread_counts)
+        {
+            ParallelFor workers;
+            workers.Start(threads);
 
-    void CreateFrameBuffer()
-    {
-        vk::ImageView vk_frame_buf_attachments[1];
-        vk_frame_buf_attachments[0] = image_view_.get();
+            SecondaryCommandRecorder recorder;
+            recorder.Init(device_.get(), graphics_queue_family_index_, threads);
 
-        vk::FramebufferCreateInfo framebuffer_create_info;
-        framebuffer_create_info.width = kScreenWidth;
-        framebuffer_create_info.height = kScreenHeight;
-        framebuffer_create_info.layers = 1;
-        framebuffer_create_info.renderPass = renderpass_.get();
-        framebuffer_create_info.attachmentCount = 1;
-        framebuffer_create_info.pAttachments = vk_frame_buf_attachments;
+            double best_ms = 0.0;
+            for (int iteration = 0; iteration < kIterations; iteration++)
+            {
+                const auto begin = std::chrono::steady_clock::now();
 
-        framebuffer_ = device_->createFramebufferUnique(framebuffer_create_info);
-    }
+                RecordDrawsInParallel(workers, recorder, frames_.front());
 
-    void CreatePipeline()
-    {
-        vk::Viewport vk_viewports[1];
-        vk_viewports[0].x = 0.0;
-        vk_viewports[0].y = 0.0;
-        vk_viewports[0].minDepth = 0.0;
-        vk_viewports[0].maxDepth = 1.0;
-        vk_viewports[0].width = kScreenWidth;
-        vk_viewports[0].height = kScreenHeight;
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+                if (iteration == 0 || ms < best_ms)
+                {
+                    best_ms = ms;
+                }
+            }
 
-        vk::Rect2D vk_scissors[1];
-        vk_scissors[0].offset = VkOffset2D{ 0, 0 };
-        vk_scissors[0].extent = VkExtent2D{ kScreenWidth, kScreenHeight };
+            if (threads == 1)
+            {
+                single_thread_ms = best_ms;
+            }
 
-        vk::PipelineViewportStateCreateInfo vk_pipeline_viewport_state_create_info;
-        vk_pipeline_viewport_state_create_info.viewportCount = 1;
-        vk_pipeline_viewport_state_create_info.pViewports = vk_viewports;
-        vk_pipeline_viewport_state_create_info.scissorCount = 1;
-        vk_pipeline_viewport_state_create_info.pScissors = vk_scissors;
+            std::cout << "  " << threads << (threads == 1 ? " thread: " : " threads: ") << std::fixed << std::setprecision(3) << best_ms << " ms"
+                << " (" << std::setprecision(2) << single_thread_ms / best_ms << "x)" << std::endl;
+            std::cout.unsetf(std::ios_base::floatfield);
+        }
+    }
 
-        vk::PipelineVertexInputStateCreateInfo vk_pipeline_vertex_input_state_create_info;
-        vk_pipeline_vertex_input_state_create_info.vertexAttributeDescriptionCount = 0;
-        vk_pipeline_vertex_input_state_create_info.pVertexAttributeDescriptions = nullptr;
-        vk_pipeline_vertex_input_state_create_info.vertexBindingDescriptionCount = 0;
-        vk_pipeline_vertex_input_state_create_info.pVertexBindingDescriptions = nullptr;
+    /**
+     * @brief ^CX^vNG쐬Avʂ̏oJ
+     */
+    void CreateTimestampQueries()
+    {
+        // ]L[ŃRs[ȂARs[̑Õ^CX^v͂̃t@~ŏ
+        const uint32_t copy_queue_family_index = copy_on_transfer_queue_ ? queue_topology_.TransferFamily() : graphics_queue_family_index_;
+        if (!gpu_timestamps_.Create(physical_device_, device_.get(), graphics_queue_family_index_, copy_queue_family_index, static_cast<uint32_t>(frames_.size())))
+        {
+            std::cout << "gpu timestamps: not supported by queue family " << graphics_queue_family_index_ << std::endl;
+        }
 
-        vk::PipelineInputAssemblyStateCreateInfo vk_pipeline_input_assembly_state_create_info;
-        vk_pipeline_input_assembly_state_create_info.topology = vk::PrimitiveTopology::eTriangleList;
-        vk_pipeline_input_assembly_state_create_info.primitiveRestartEnable = false;
+        if (!options_.stats_json_path.empty())
+        {
+            stats_json_.open(options_.stats_json_path, std::ios_base::trunc);
+            if (!stats_json_)
+            {
+                throw std::runtime_error("Failed to open " + options_.stats_json_path + "!");
+            }
+        }
+    }
 
-        vk::PipelineRasterizationStateCreateInfo vk_pipeline_rasterization_state_create_info;
-        vk_pipeline_rasterization_state_create_info.depthClampEnable = false;
-        vk_pipeline_rasterization_state_create_info.rasterizerDiscardEnable = false;
-        vk_pipeline_rasterization_state_create_info.polygonMode = vk::PolygonMode::eFill;
-        vk_pipeline_rasterization_state_create_info.lineWidth = 1.0f;
-        vk_pipeline_rasterization_state_create_info.cullMode = vk::CullModeFlagBits::eBack;
-        vk_pipeline_rasterization_state_create_info.frontFace = vk::FrontFace::eClockwise;
-        vk_pipeline_rasterization_state_create_info.depthBiasEnable = false;
+    /**
+     * @brief PNG̈kxݒ肵AdeflateiJPEGȂGgs[j𕪒S郏[J[N
+     */
+    void StartDeflateWorkers()
+    {
+        if (options_.image_format == ImageFormat::Bmp)
+        {
+            return;
+        }
 
-        vk::PipelineMultisampleStateCreateInfo vk_pipeline_multisample_state_create_info;
-        vk_pipeline_multisample_state_create_info.sampleShadingEnable = false;
-        vk_pipeline_multisample_state_create_info.rasterizationSamples = vk::SampleCountFlagBits::e1;
+        stbi_write_png_compression_level = options_.png_compression_level;
 
-        vk::PipelineColorBlendAttachmentState vk_pipeline_color_blend_attachment_states[1];
-        vk_pipeline_color_blend_attachment_states[0].colorWriteMask =
-            vk::ColorComponentFlagBits::eA |
-            vk::ColorComponentFlagBits::eR |
-            vk::ColorComponentFlagBits::eG |
-            vk::ColorComponentFlagBits::eB;
-        vk_pipeline_color_blend_attachment_states[0].blendEnable = false;
+        if (options_.deflate_threads > 1)
+        {
+            deflate_workers_.Start(options_.deflate_threads);
+            stbi_write_set_parallel_for(ParallelFor::Invoke, &deflate_workers_);
+        }
 
-        vk::PipelineColorBlendStateCreateInfo blend;
-        blend.logicOpEnable = false;
-        blend.attachmentCount = 1;
-        blend.pAttachments = vk_pipeline_color_blend_attachment_states;
+        if (options_.image_format == ImageFormat::Jpg)
+        {
+            std::cout << "jpg: quality " << options_.jpg_quality << ", entropy coding on " << deflate_workers_.ThreadCount() << " threads";
+            if (deflate_workers_.ThreadCount() > 1)
+            {
+                std::cout << " (restart interval every " << stbi_write_jpg_band_rows << " MCU rows)";
+            }
+            std::cout << std::endl;
+            return;
+        }
 
-        vk::PipelineLayoutCreateInfo vk_pipeline_layout_create_info;
-        vk_pipeline_layout_create_info.setLayoutCount = 0;
-        vk_pipeline_layout_create_info.pSetLayouts = nullptr;
+        std::cout << "png: compression level " << options_.png_compression_level << ", deflate on " << deflate_workers_.ThreadCount() << " threads" << std::endl;
+    }
 
-        vk::UniquePipelineLayout vk_pipeline_layout = device_->createPipelineLayoutUnique(vk_pipeline_layout_create_info);
+    /**
+     * @brief t[̃_[^[QbgjAAP[^֕Ԃ
+     * @param frame `悪Ăt[̃\[X
+     */
+    void DestroyRenderTarget(FrameContext& frame)
+    {
+        // C[WjĂ烁Ԃ
+        frame.framebuffers.clear();
+        frame.image_views.clear();
+        frame.image.reset();
+        allocator_.Free(frame.image_alloc);
+    }
 
-        vk::PipelineShaderStageCreateInfo vk_pipeline_shader_stage_create_infos[2];
-        vk_pipeline_shader_stage_create_infos[0].stage = vk::ShaderStageFlagBits::eVertex;
-        vk_pipeline_shader_stage_create_infos[0].module = vert_shader_.get();
-        vk_pipeline_shader_stage_create_infos[0].pName = "main";
-        vk_pipeline_shader_stage_create_infos[1].stage = vk::ShaderStageFlagBits::eFragment;
-        vk_pipeline_shader_stage_create_infos[1].module = frag_shader_.get();
-        vk_pipeline_shader_stage_create_infos[1].pName = "main";
+    /**
+     * @brief Wủ𑜓xƃtH[}bgɍ킹ă_[^[Qbgpӂ
+     *
+     * tH[}bgςꍇ̓_[pXƃpCvC蒼B
+     * r[|[gƃVU[͓IXe[gȂ̂ŁA𑜓xςꍇ̓pCvĈ܂܎gA
+     * _[^[QbgƓǂݏopobt@蒼BǂςȂΉȂ
+     * @param job `悷Wu
+     * @param timer Ƃ̌oߎԂL^^C}[
+     */
+    void PrepareJob(const RenderJob& job, PhaseTimer& timer)
+    {
+        const bool format_changed = job.format != format_;
+        const bool extent_changed = job.extent != extent_;
 
-        vk::GraphicsPipelineCreateInfo vk_graphics_pipeline_create_info;
-        vk_graphics_pipeline_create_info.pViewportState = &vk_pipeline_viewport_state_create_info;
-        vk_graphics_pipeline_create_info.pVertexInputState = &vk_pipeline_vertex_input_state_create_info;
-        vk_graphics_pipeline_create_info.pInputAssemblyState = &vk_pipeline_input_assembly_state_create_info;
-        vk_graphics_pipeline_create_info.pRasterizationState = &vk_pipeline_rasterization_state_create_info;
-        vk_graphics_pipeline_create_info.pMultisampleState = &vk_pipeline_multisample_state_create_info;
-        vk_graphics_pipeline_create_info.pColorBlendState = &blend;
-        vk_graphics_pipeline_create_info.layout = vk_pipeline_layout.get();
-        vk_graphics_pipeline_create_info.renderPass = renderpass_.get();
-        vk_graphics_pipeline_create_info.subpass = 0;
-        vk_graphics_pipeline_create_info.stageCount = 2;
-        vk_graphics_pipeline_create_info.pStages = vk_pipeline_shader_stage_create_infos;
+        if (!format_changed && !extent_changed)
+        {
+            std::cout << "render targets: reusing " << extent_.width << "x" << extent_.height << std::endl;
+            return;
+        }
 
-        pipeline_ = device_->createGraphicsPipelineUnique(nullptr, vk_graphics_pipeline_create_info).value;
-    }
+        const vk::PhysicalDeviceLimits limits = physical_device_.getProperties().limits;
+        if (job.extent.width > std::min(limits.maxImageDimension2D, limits.maxFramebufferWidth) ||
+            job.extent.height > std::min(limits.maxImageDimension2D, limits.maxFramebufferHeight))
+        {
+            throw std::runtime_error("Render target size " + std::to_string(job.extent.width) + "x" + std::to_string(job.extent.height) + " exceeds the device limits!");
+        }
 
-    void LoadVertShader()
-    {
-        const size_t vert_spv_file_sz = std::filesystem::file_size("SampleShader\\VertexSample.spv");
+        if (!(physical_device_.getFormatProperties(job.format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eColorAttachment))
+        {
+            throw std::runtime_error("Format " + vk::to_string(job.format) + " cannot be used as a color attachment!");
+        }
 
-        std::ifstream vert_spv_file("SampleShader\\VertexSample.spv", std::ios_base::binary);
+        if (options_.layer_count > 1)
+        {
+            const vk::ImageFormatProperties image_format_properties = physical_device_.getImageFormatProperties(job.format, vk::ImageType::e2D,
+                vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eColorAttachment);
+            if (options_.layer_count > image_format_properties.maxArrayLayers)
+            {
+                throw std::runtime_error("--layers " + std::to_string(options_.layer_count) + " exceeds the maximum array layers (" +
+                    std::to_string(image_format_properties.maxArrayLayers) + ") of " + vk::to_string(job.format) + "!");
+            }
+        }
 
-        std::vector<char> vert_spv_file_data(vert_spv_file_sz);
-        vert_spv_file.read(vert_spv_file_data.data(), vert_spv_file_sz);
+        std::cout << "render targets: " << job.extent.width << "x" << job.extent.height << " " << vk::to_string(job.format);
+        if (options_.layer_count > 1)
+        {
+            std::cout << ", " << options_.layer_count << " layers";
+        }
+        std::cout << std::endl;
 
-        vk::ShaderModuleCreateInfo vk_vert_shader_create_info;
-        vk_vert_shader_create_info.codeSize = vert_spv_file_sz;
-        vk_vert_shader_create_info.pCode = reinterpret_cast<const uint32_t*>(vert_spv_file_data.data());
+        // ÕWũt[ׂ͂ďoς݂Ȃ̂ŁÂ܂ܔjłB
+        // L^ς݂̃R}hobt@͔j郌_[^[QbgpCvCQƂĂ̂ŁAL^
+        for (FrameContext& frame : frames_)
+        {
+            DestroyRenderTarget(frame);
+            frame.commands.Invalidate();
+            frame.copy_commands.Invalidate();
+            frame.draws.Invalidate();
+        }
 
-        vert_shader_ = device_->createShaderModuleUnique(vk_vert_shader_create_info);
-    }
+        extent_ = job.extent;
+        format_ = job.format;
 
-    void LoadFragmentShader()
-    {
-	    const size_t frag_spv_file_sz = std::filesystem::file_size("SampleShader\\FragmentSample.spv");
+        // `挋ʂ̓ǂݏo@̑IiLinearŕ`ł邩͉𑜓xƃtH[}bgɂj
+        timer.Measure("SelectReadbackMode", [&] { SelectReadbackMode(); });
 
-        std::ifstream frag_spv_file("SampleShader\\FragmentSample.spv", std::ios_base::binary);
+        if (format_changed)
+        {
+            pipeline_.reset();
+            renderpass_.reset();
 
-        std::vector<char> frag_spv_file_data(frag_spv_file_sz);
-        frag_spv_file.read(frag_spv_file_data.data(), frag_spv_file_sz);
+            // _[pX̍쐬
+            timer.Measure("CreateRenderPass", [&] { CreateRenderPass(); });
 
-        vk::ShaderModuleCreateInfo frag_shader_create_info;
-        frag_shader_create_info.codeSize = frag_spv_file_sz;
-        frag_shader_create_info.pCode = reinterpret_cast<const uint32_t*>(frag_spv_file_data.data());
+            // pCvC̍쐬
+            const double create_pipeline_ms = timer.Measure("CreatePipeline", [&] { CreatePipeline(); });
 
-        frag_shader_ = device_->createShaderModuleUnique(frag_shader_create_info);
-    }
+            std::cout << "pipeline creation: " << std::fixed << std::setprecision(3) << create_pipeline_ms << " ms ("
+                << (!pipeline_cache_file_ ? "no cache" : pipeline_cache_file_->IsWarm() ? "warm cache" : "cold cache") << ")" << std::endl;
+            std::cout.unsetf(std::ios_base::floatfield);
+        }
 
-    void WriteImage()
-    {
-        void* image_data = device_->mapMemory(buffer_mem_.get(), 0, buffer_mem_req_.size);
+        // C[WƃC[Wr[̍쐬
+        timer.Measure("CreateImage", [&]
+        {
+            for (FrameContext& frame : frames_)
+            {
+                frame.linear = linear_render_target_;
+                CreateImage(frame);
+            }
+        });
+        timer.Measure("CreateImageView", [&] { for (FrameContext& frame : frames_) CreateImageView(frame); });
 
-        stbi_write_bmp("image.bmp", kScreenWidth, kScreenHeight, 4, image_data);
+        // t[obt@̍쐬
+        timer.Measure("CreateFrameBuffer", [&] { for (FrameContext& frame : frames_) CreateFrameBuffer(frame); });
 
-        device_->unmapMemory(buffer_mem_.get());
+        // ǂݏopobt@̍쐬
+        timer.Measure("CreateReadbackBuffers", [&] { CreateReadbackBuffers(); });
     }
 
     void InitVulkan()
     {
         // VulkanCX^X̍쐬
-        CreateInstance();
+        phase_timer_.Measure("CreateInstance", [&] { CreateInstance(); });
 
         // foCX̎擾
-        GetPhysicalDevices();
+        phase_timer_.Measure("GetPhysicalDevices", [&] { GetPhysicalDevices(); });
 
 #ifndef NDEBUG
         // foCX̕\
@@ -514,95 +2473,143 @@ private:
 #endif
 
         // foCX̑I
-        SelectPhysicalDevice();
+        phase_timer_.Measure("SelectPhysicalDevice", [&] { SelectPhysicalDevice(); });
 
         // _foCX̍쐬ƁAL[̎擾
-        CreateLogicalDevice();
+        phase_timer_.Measure("CreateLogicalDevice", [&] { CreateLogicalDevice(); });
+
+        // t[Ƃ̃\[X̗p
+        phase_timer_.Measure("CreateFrameContexts", [&] { CreateFrameContexts(); });
 
         // R}hv[̍쐬
-        CreateCommandPool();
+        phase_timer_.Measure("CreateCommandPool", [&] { CreateCommandPool(); });
 
         // R}hobt@̍쐬
-        CreateCommandBuffers();
+        phase_timer_.Measure("CreateCommandBuffers", [&] { CreateCommandBuffers(); });
 
-        // C[WƃC[Wr[̍쐬
-        CreateImage();
-        CreateImageView();
+        // GPUԂv^CX^vNG̍쐬
+        phase_timer_.Measure("CreateTimestampQueries", [&] { CreateTimestampQueries(); });
 
         // o[ebNXVF[_[ƃtOgVF[_[̓ǂݍ
-        LoadVertShader();
-        LoadFragmentShader();
+        phase_timer_.Measure("LoadVertShader", [&] { LoadVertShader(); });
+        phase_timer_.Measure("LoadFragmentShader", [&] { LoadFragmentShader(); });
 
-        // _[pX̍쐬
-        CreateRenderPass();
+        // pCvCLbV̓ǂݍ
+        phase_timer_.Measure("LoadPipelineCache", [&] { LoadPipelineCache(); });
 
-        // t[obt@̍쐬
-        CreateFrameBuffer();
+        // 摜GR[h郏[J[̋Niǂݏopobt@̐͂̃L[̐[Ō܂j
+        phase_timer_.Measure("StartEncoderPool", [&] { encoder_pool_.Start(options_.encode_threads, options_.encode_queue_depth); });
+
+        // PNGdeflate𕪒S郏[J[̋N
+        phase_timer_.Measure("StartDeflateWorkers", [&] { StartDeflateWorkers(); });
 
-        // pCvC̍쐬
-        CreatePipeline();
+        // ŏ̃Wũ_[pXApCvCA_[^[Qbg̍쐬
+        PrepareJob(options_.jobs.front(), phase_timer_);
 
-        vk::CommandBufferBeginInfo cmd_begin_info;
-        cmd_bufs_[0]->begin(cmd_begin_info);
+        phase_timer_.Print();
 
-        vk::ClearValue clear_val[1];
-        clear_val[0].color.float32[0] = 0.0f;
-        clear_val[0].color.float32[1] = 1.0f;
-        clear_val[0].color.float32[2] = 0.0f;
-        clear_val[0].color.float32[3] = 1.0f;
+        allocator_.PrintStatistics();
+    }
 
-        vk::RenderPassBeginInfo vk_render_pass_begin;
-        vk_render_pass_begin.renderPass = renderpass_.get();
-        vk_render_pass_begin.framebuffer = framebuffer_.get();
-        vk_render_pass_begin.renderArea = vk::Rect2D({ 0,0 }, { kScreenWidth, kScreenHeight });
-        vk_render_pass_begin.clearValueCount = 1;
-        vk_render_pass_begin.pClearValues = clear_val;
+    /**
+     * @brief pCvCLbVt@Cǂݍ
+     */
+    void LoadPipelineCache()
+    {
+        if (options_.pipeline_cache_path.empty())
+        {
+            return;
+        }
 
-        cmd_bufs_[0]->beginRenderPass(vk_render_pass_begin, vk::SubpassContents::eInline);
+        pipeline_cache_file_ = std::make_unique<PipelineCacheFile>(options_.pipeline_cache_path);
+        pipeline_cache_ = pipeline_cache_file_->Load(physical_device_, device_.get());
+    }
 
-        // ŃTupX0Ԃ̏
+    /**
+     * @brief IuWFNg̃N[Abv
+     */
+    void CleanUp()
+    {
+        // deflate_workers_͂̌ĵŁAstb_image_writeO
+        stbi_write_set_parallel_for(nullptr, nullptr);
 
-        cmd_bufs_[0]->bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_.get());
+        // ̋N̂߂ɃpCvCLbV߂
+        if (pipeline_cache_file_)
+        {
+            pipeline_cache_file_->Save(device_.get(), pipeline_cache_.get());
+        }
+    }
+};
 
-        cmd_bufs_[0]->draw(3, 1, 0, 0);
+/**
+ * @brief of[Ṽ[hƂɃAvP[VŜsAԂr
+ *
+ * C[ׂ͂ĂVulkaňĂяoɊ荞ނ̂ŁAƃt[̑M̗xȂB
+ * Ɏs[hhCo[̏pCvC̃RpC𕉒SȂ悤A
+ * v̑OɈxvȂŎsAǂ̃[hpCvCLbṼt@Cg킸Ɏs
+ * @param options sIvVivalidation_mode̓[hƂɒuj
+ */
+void BenchmarkLayers(const AppOptions& options)
+{
+    const ValidationMode modes[] = { ValidationMode::None, ValidationMode::Standard, ValidationMode::GpuAssisted };
 
-        cmd_bufs_[0]->endRenderPass();
+    AppOptions bench_options = options;
+    bench_options.bench_layers = false;
+    bench_options.pipeline_cache_path.clear();
 
-        cmd_bufs_[0]->copyImageToBuffer(
-            image_.get(), 
-            vk::ImageLayout::eGeneral, 
-            buffer_.get(), 
-            vk::BufferImageCopy{ 0, kScreenWidth, kScreenHeight, vk::ImageSubresourceLayers{vk::ImageAspectFlagBits::eColor, 0, 0, 1}, vk::Offset3D{0, 0, 0}, vk::Extent3D{kScreenWidth, kScreenHeight, 1} }
-        );
+    // EH[AbvivȂj
+    {
+        AppOptions warm_up_options = bench_options;
+        warm_up_options.validation_mode = ValidationMode::None;
+        App app(warm_up_options);
+        app.run();
+    }
 
+    std::vector<std::pair<ValidationMode, double>> results;
 
-        cmd_bufs_[0]->end();
+    for (const ValidationMode mode : modes)
+    {
+        if (!LayerConfig::IsAvailable(mode))
+        {
+            std::cout << "validation " << LayerConfig::ToString(mode) << ": not installed (skipped)" << std::endl;
+            continue;
+        }
 
-        const vk::CommandBuffer submit_cmd_buf[1] = { cmd_bufs_[0].get() };
-        vk::SubmitInfo submitInfo;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = submit_cmd_buf;
+        AppOptions mode_options = bench_options;
+        mode_options.validation_mode = mode;
 
-        graphics_queue_.submit({ submitInfo }, nullptr);
-        
-        graphics_queue_.waitIdle();
+        const auto begin = std::chrono::steady_clock::now();
+        {
+            App app(mode_options);
+            app.run();
+        }
+        const auto end = std::chrono::steady_clock::now();
 
-        // o
-        WriteImage();
+        results.emplace_back(mode, std::chrono::duration<double, std::milli>(end - begin).count());
     }
 
-    /**
-     * @brief IuWFNg̃N[Abv
-     */
-    void CleanUp()
+    std::cout << "validation overhead (" << options.frame_count << " frames per job, after one untimed warm-up run, no pipeline cache):" << std::endl;
+    for (const auto& [mode, ms] : results)
     {
+        std::cout << "  " << std::left << std::setw(10) << LayerConfig::ToString(mode) << std::right
+            << std::fixed << std::setprecision(3) << std::setw(12) << ms << " ms"
+            << std::setprecision(2) << "  x" << ms / results.front().second << std::endl;
     }
-};
+    std::cout.unsetf(std::ios_base::floatfield | std::ios_base::adjustfield);
+}
 
-int main() {
+int main(int argc, char** argv) {
 	try
 	{
-		App app;
+		const AppOptions options = AppOptions::Parse(argc, argv);
+
+		if (options.bench_layers)
+		{
+			BenchmarkLayers(options);
+			return EXIT_SUCCESS;
+		}
+
+		App app(options);
 		app.run();
     }
     catch (vk::SystemError& err)
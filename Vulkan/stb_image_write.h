@@ -1,4 +1,4 @@
-﻿/* stb_image_write - v1.16 - public domain - http://nothings.org/stb
+/* stb_image_write - v1.16 - public domain - http://nothings.org/stb
    writes out PNG/BMP/TGA/JPEG/HDR images to C stdio - Sean Barrett 2010-2015
                                      no warranty implied; use at your own risk
 
@@ -68,6 +68,9 @@ USAGE:
       int stbi_write_tga_with_rle;             // defaults to true; set to 0 to disable RLE
       int stbi_write_png_compression_level;    // defaults to 8; set to higher for more compression
       int stbi_write_force_png_filter;         // defaults to -1; set to 0..5 to force a filter mode
+      int stbi_write_simd_level;               // defaults to -1 (best the CPU supports); 0 scalar, 1 SSE2/NEON, 2 AVX2
+      int stbi_write_zlib_chunk_size;          // defaults to 128K; input bytes per chunk of a parallel deflate
+      int stbi_write_jpg_band_rows;            // defaults to 8; MCU rows per band of a parallel JPEG (0 disables)
 
 
    You can define STBI_WRITE_NO_STDIO to disable the file variant of these
@@ -99,6 +102,37 @@ USAGE:
    PNG allows you to set the deflate compression level by setting the global
    variable 'stbi_write_png_compression_level' (it defaults to 8).
 
+   The builtin deflate can run on several threads. Install a parallel-for with
+   stbi_write_set_parallel_for(); the input is then split into chunks of
+   'stbi_write_zlib_chunk_size' bytes that are compressed concurrently (each one
+   primed with the 32K window before it) and joined with sync flushes into a
+   single zlib stream. The files get slightly larger than the serial ones.
+
+   stbi_write_png() and stbi_write_png_to_func() stream: rows are filtered into
+   a window that holds one batch of deflate chunks (STBIW_PNG_STREAM_CHUNKS of
+   them with a parallel-for, otherwise one) plus the 32K before it, and each
+   compressed chunk goes out at once as its own IDAT. Memory stays near that
+   window whatever the image height. stbi_write_png_to_mem() still builds the
+   whole file in memory; with a parallel-for both give the same zlib stream.
+
+   The JPEG entropy coder uses the same parallel-for. The image is cut into bands
+   of 'stbi_write_jpg_band_rows' MCU rows (16 or 8 pixel rows each); each band is
+   one restart interval, coded on its own and joined to the next with an RSTn
+   marker, and a DRI segment announces the interval. The result is an ordinary
+   baseline JPEG, a few bytes per band larger than the serial one. Without a
+   parallel-for (or with a single band) no restart markers are written.
+
+   PNG row filtering uses SSE2/AVX2 (x86) or NEON (ARM) when the compiler
+   targets them; the kernel is chosen at run time from what the CPU supports.
+   Set 'stbi_write_simd_level' to 0 to force the scalar code (or 1 to stay off
+   AVX2); the output is identical at every level. Define STBIW_NO_SIMD to leave
+   the SIMD kernels out entirely.
+
+   BMP and uncompressed TGA are converted a whole row at a time (the RGB/RGBA
+   swizzle is vectorized) and written in batches of about STBIW_ROW_BATCH_BYTES
+   (256K by default); if that buffer can't be allocated they fall back to
+   writing pixel by pixel.
+
    HDR expects linear float data. Since the format is always 32-bit rgb(e)
    data, alpha (if provided) is discarded, and for monochrome data it is
    replicated across all three channels.
@@ -170,6 +204,9 @@ LICENSE
 STBIWDEF int stbi_write_tga_with_rle;
 STBIWDEF int stbi_write_png_compression_level;
 STBIWDEF int stbi_write_force_png_filter;
+STBIWDEF int stbi_write_simd_level;
+STBIWDEF int stbi_write_zlib_chunk_size;
+STBIWDEF int stbi_write_jpg_band_rows;
 #endif
 
 #ifndef STBI_WRITE_NO_STDIO
@@ -194,6 +231,12 @@ STBIWDEF int stbi_write_jpg_to_func(stbi_write_func* func, void* context, int x,
 
 STBIWDEF void stbi_flip_vertically_on_write(int flip_boolean);
 
+// Runs task(task_context, index) for every index in [0, count), possibly concurrently,
+// and returns when all of them have finished.
+typedef void stbi_write_parallel_for_func(void* context, int count, void (*task)(void* task_context, int index), void* task_context);
+
+STBIWDEF void stbi_write_set_parallel_for(stbi_write_parallel_for_func* func, void* context);
+
 #endif//INCLUDE_STB_IMAGE_WRITE_H
 
 #ifdef STB_IMAGE_WRITE_IMPLEMENTATION
@@ -251,11 +294,101 @@ STBIWDEF void stbi_flip_vertically_on_write(int flip_boolean);
 static int stbi_write_png_compression_level = 8;
 static int stbi_write_tga_with_rle = 1;
 static int stbi_write_force_png_filter = -1;
+static int stbi_write_simd_level = -1;
+static int stbi_write_zlib_chunk_size = 128 * 1024;
+static int stbi_write_jpg_band_rows = 8;
 #else
 int stbi_write_png_compression_level = 8;
 int stbi_write_tga_with_rle = 1;
 int stbi_write_force_png_filter = -1;
+int stbi_write_simd_level = -1;
+int stbi_write_zlib_chunk_size = 128 * 1024;
+int stbi_write_jpg_band_rows = 8;
+#endif
+
+// SIMD kernels for PNG row filtering, CRC32 and Adler32; compiled in when the target
+// has them and chosen at run time (see stbi_write_simd_level). Define STBIW_NO_SIMD to opt out.
+#ifndef STBIW_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STBIW__SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define STBIW__AVX2
+#define STBIW__TARGET_AVX2
+#define STBIW__PCLMUL
+#define STBIW__TARGET_PCLMUL
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) || defined(__clang__)
+#define STBIW__AVX2
+#define STBIW__TARGET_AVX2 __attribute__((target("avx2")))
+#define STBIW__PCLMUL
+#define STBIW__TARGET_PCLMUL __attribute__((target("pclmul")))
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define STBIW__NEON
+#include <arm_neon.h>
+#endif
+// the ARMv8 CRC32 instructions are optional before ARMv8.1, so they are only used when the compiler targets them
+#if defined(__ARM_FEATURE_CRC32)
+#define STBIW__ARM_CRC32
+#include <arm_acle.h>
+#endif
+#endif
+
+enum
+{
+    STBIW__SIMD_SCALAR = 0,
+    STBIW__SIMD_SSE2 = 1,   // also NEON
+    STBIW__SIMD_AVX2 = 2
+};
+
+static int stbiw__detect_simd_level(void)
+{
+#if defined(STBIW__AVX2) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0)
+        if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5))
+                return STBIW__SIMD_AVX2;
+        }
+    }
+    return STBIW__SIMD_SSE2;
+#elif defined(STBIW__AVX2)
+    return __builtin_cpu_supports("avx2") ? STBIW__SIMD_AVX2 : STBIW__SIMD_SSE2;
+#elif defined(STBIW__SSE2) || defined(STBIW__NEON)
+    return STBIW__SIMD_SSE2;
+#else
+    return STBIW__SIMD_SCALAR;
 #endif
+}
+
+static int stbiw__cpu_has_pclmul(void)
+{
+#if defined(STBIW__PCLMUL) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) != 0;
+#elif defined(STBIW__PCLMUL)
+    return __builtin_cpu_supports("pclmul");
+#else
+    return 0;
+#endif
+}
+
+// the level to use for one image: the requested one, clamped to what the CPU supports
+static int stbiw__simd_level(void)
+{
+    int detected = stbiw__detect_simd_level();
+    if (stbi_write_simd_level < 0 || stbi_write_simd_level > detected)
+        return detected;
+    return stbi_write_simd_level;
+}
 
 static int stbi__flip_vertically_on_write = 0;
 
@@ -264,6 +397,15 @@ STBIWDEF void stbi_flip_vertically_on_write(int flag)
     stbi__flip_vertically_on_write = flag;
 }
 
+static stbi_write_parallel_for_func* stbiw__parallel_for = NULL;
+static void* stbiw__parallel_for_context = NULL;
+
+STBIWDEF void stbi_write_set_parallel_for(stbi_write_parallel_for_func* func, void* context)
+{
+    stbiw__parallel_for = func;
+    stbiw__parallel_for_context = context;
+}
+
 typedef struct
 {
     stbi_write_func* func;
@@ -403,61 +545,167 @@ static void stbiw__write1(stbi__write_context* s, unsigned char a)
     s->buffer[s->buf_used++] = a;
 }
 
-static void stbiw__write3(stbi__write_context* s, unsigned char a, unsigned char b, unsigned char c)
-{
-    int n;
-    if ((size_t)s->buf_used + 3 > sizeof(s->buffer))
-        stbiw__write_flush(s);
-    n = s->buf_used;
-    s->buf_used = n + 3;
-    s->buffer[n + 0] = a;
-    s->buffer[n + 1] = b;
-    s->buffer[n + 2] = c;
-}
-
-static void stbiw__write_pixel(stbi__write_context* s, int rgb_dir, int comp, int write_alpha, int expand_mono, unsigned char* d)
+// The bytes stbiw__write_pixel writes for one pixel; returns how many (at most 5)
+static int stbiw__pixel_bytes(int rgb_dir, int comp, int write_alpha, int expand_mono, const unsigned char* d, unsigned char* out)
 {
     unsigned char bg[3] = { 255, 0, 255 }, px[3];
-    int k;
+    int k, n = 0;
 
     if (write_alpha < 0)
-        stbiw__write1(s, d[comp - 1]);
+        out[n++] = d[comp - 1];
 
     switch (comp) {
     case 2: // 2 pixels = mono + alpha, alpha is written separately, so same as 1-channel case
     case 1:
-        if (expand_mono)
-            stbiw__write3(s, d[0], d[0], d[0]); // monochrome bmp
+        if (expand_mono) {
+            out[n++] = d[0]; out[n++] = d[0]; out[n++] = d[0]; // monochrome bmp
+        }
         else
-            stbiw__write1(s, d[0]);  // monochrome TGA
+            out[n++] = d[0];  // monochrome TGA
         break;
     case 4:
         if (!write_alpha) {
             // composite against pink background
             for (k = 0; k < 3; ++k)
                 px[k] = bg[k] + ((d[k] - bg[k]) * d[3]) / 255;
-            stbiw__write3(s, px[1 - rgb_dir], px[1], px[1 + rgb_dir]);
+            out[n++] = px[1 - rgb_dir]; out[n++] = px[1]; out[n++] = px[1 + rgb_dir];
             break;
         }
         /* FALLTHROUGH */
     case 3:
-        stbiw__write3(s, d[1 - rgb_dir], d[1], d[1 + rgb_dir]);
+        out[n++] = d[1 - rgb_dir]; out[n++] = d[1]; out[n++] = d[1 + rgb_dir];
         break;
     }
     if (write_alpha > 0)
-        stbiw__write1(s, d[comp - 1]);
+        out[n++] = d[comp - 1];
+    return n;
 }
 
-static void stbiw__write_pixels(stbi__write_context* s, int rgb_dir, int vdir, int x, int y, int comp, void* data, int write_alpha, int scanline_pad, int expand_mono)
+static void stbiw__write_pixel(stbi__write_context* s, int rgb_dir, int comp, int write_alpha, int expand_mono, unsigned char* d)
 {
-    stbiw_uint32 zero = 0;
-    int i, j, j_end;
+    unsigned char px[5];
+    int n = stbiw__pixel_bytes(rgb_dir, comp, write_alpha, expand_mono, d, px);
+    if ((size_t)s->buf_used + n > sizeof(s->buffer))
+        stbiw__write_flush(s);
+    memcpy(s->buffer + s->buf_used, px, n);
+    s->buf_used += n;
+}
 
-    if (y <= 0)
-        return;
+// Swizzles of whole rows for the two common BMP/TGA layouts: RGB -> BGR and RGBA -> BGRA. Each
+// returns how many pixels it converted; the rest goes through stbiw__pixel_bytes. The AVX2 level
+// also uses the 128-bit SSSE3 byte shuffle, which every AVX2 CPU has.
+#ifdef STBIW__SSE2
+static int stbiw__swap_rb32_sse2(const unsigned char* in, int count, unsigned char* out)
+{
+    const __m128i ga_mask = _mm_set1_epi32((int)0xFF00FF00u);
+    const __m128i rb_mask = _mm_set1_epi32(0x00FF00FF);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 4));
+        __m128i rb = _mm_and_si128(v, rb_mask);
+        rb = _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16));
+        _mm_storeu_si128((__m128i*)(out + i * 4), _mm_or_si128(_mm_and_si128(v, ga_mask), rb));
+    }
+    return i;
+}
+#endif
 
-    if (stbi__flip_vertically_on_write)
-        vdir *= -1;
+#ifdef STBIW__AVX2
+STBIW__TARGET_AVX2 static int stbiw__swap_rb32_avx2(const unsigned char* in, int count, unsigned char* out)
+{
+    const __m256i order = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                           2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_si256((__m256i*)(out + i * 4), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(in + i * 4)), order));
+    return i;
+}
+
+// 5 pixels per 16-byte shuffle; the 16th byte is stored unswapped and overwritten by the next step (or the
+// scalar tail), and the loop stops while the 16 bytes are still inside the row
+STBIW__TARGET_AVX2 static int stbiw__swap_rb24_avx2(const unsigned char* in, int count, unsigned char* out)
+{
+    const __m128i order = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    int i = 0;
+    for (; i * 3 + 16 <= count * 3; i += 5)
+        _mm_storeu_si128((__m128i*)(out + i * 3), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + i * 3)), order));
+    return i;
+}
+#endif
+
+#ifdef STBIW__NEON
+static int stbiw__swap_rb32_neon(const unsigned char* in, int count, unsigned char* out)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x4_t px = vld4q_u8(in + i * 4);
+        uint8x16_t r = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = r;
+        vst4q_u8(out + i * 4, px);
+    }
+    return i;
+}
+
+static int stbiw__swap_rb24_neon(const unsigned char* in, int count, unsigned char* out)
+{
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        uint8x16x3_t px = vld3q_u8(in + i * 3);
+        uint8x16_t r = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = r;
+        vst3q_u8(out + i * 3, px);
+    }
+    return i;
+}
+#endif
+
+// Convert one row to the bytes stbiw__write_pixel would write for it; returns the byte count
+static int stbiw__convert_row(int simd_level, int rgb_dir, int comp, int write_alpha, int expand_mono, const unsigned char* row, int x, unsigned char* out)
+{
+    int i = 0, n = 0;
+    if (rgb_dir == -1 && comp == 4 && write_alpha > 0) {
+#ifdef STBIW__AVX2
+        if (simd_level >= STBIW__SIMD_AVX2)
+            i = stbiw__swap_rb32_avx2(row, x, out);
+        else
+#endif
+#ifdef STBIW__SSE2
+        if (simd_level >= STBIW__SIMD_SSE2)
+            i = stbiw__swap_rb32_sse2(row, x, out);
+#endif
+#ifdef STBIW__NEON
+        if (simd_level >= STBIW__SIMD_SSE2)
+            i = stbiw__swap_rb32_neon(row, x, out);
+#endif
+        n = i * 4;
+    }
+    else if (rgb_dir == -1 && comp == 3 && write_alpha == 0) {
+#ifdef STBIW__AVX2
+        if (simd_level >= STBIW__SIMD_AVX2)
+            i = stbiw__swap_rb24_avx2(row, x, out);
+#endif
+#ifdef STBIW__NEON
+        if (simd_level >= STBIW__SIMD_SSE2)
+            i = stbiw__swap_rb24_neon(row, x, out);
+#endif
+        n = i * 3;
+    }
+    (void)simd_level;
+    for (; i < x; ++i)
+        n += stbiw__pixel_bytes(rgb_dir, comp, write_alpha, expand_mono, row + i * comp, out + n);
+    return n;
+}
+
+#ifndef STBIW_ROW_BATCH_BYTES
+#define STBIW_ROW_BATCH_BYTES (256 * 1024)   // converted rows are handed to the write callback in batches of about this size
+#endif
+
+static void stbiw__write_pixels_slow(stbi__write_context* s, int rgb_dir, int vdir, int x, int y, int comp, void* data, int write_alpha, int scanline_pad, int expand_mono)
+{
+    stbiw_uint32 zero = 0;
+    int i, j, j_end;
 
     if (vdir < 0) {
         j_end = -1; j = y - 1;
@@ -476,6 +724,52 @@ static void stbiw__write_pixels(stbi__write_context* s, int rgb_dir, int vdir, i
     }
 }
 
+static void stbiw__write_pixels(stbi__write_context* s, int rgb_dir, int vdir, int x, int y, int comp, void* data, int write_alpha, int scanline_pad, int expand_mono)
+{
+    int j, j_end, row_bytes, batch_rows, rows, used;
+    int simd_level = stbiw__simd_level();
+    unsigned char* buffer;
+
+    if (y <= 0)
+        return;
+
+    if (stbi__flip_vertically_on_write)
+        vdir *= -1;
+
+    // the rows are converted a whole row at a time into one buffer and written together
+    row_bytes = x * ((comp <= 2 && !expand_mono ? 1 : 3) + (write_alpha ? 1 : 0)) + scanline_pad;
+    if (row_bytes <= 0)
+        return;
+    batch_rows = STBIW_ROW_BATCH_BYTES / row_bytes;
+    batch_rows = batch_rows < 1 ? 1 : batch_rows > y ? y : batch_rows;
+    buffer = (unsigned char*)STBIW_MALLOC((size_t)batch_rows * row_bytes);
+    if (buffer == NULL) {
+        stbiw__write_pixels_slow(s, rgb_dir, vdir, x, y, comp, data, write_alpha, scanline_pad, expand_mono);
+        return;
+    }
+
+    if (vdir < 0) {
+        j_end = -1; j = y - 1;
+    }
+    else {
+        j_end = y; j = 0;
+    }
+
+    stbiw__write_flush(s);
+    for (rows = 0, used = 0; j != j_end; j += vdir) {
+        used += stbiw__convert_row(simd_level, rgb_dir, comp, write_alpha, expand_mono, (unsigned char*)data + (size_t)j * x * comp, x, buffer + used);
+        memset(buffer + used, 0, scanline_pad);
+        used += scanline_pad;
+        if (++rows == batch_rows) {
+            s->func(s->context, buffer, used);
+            rows = used = 0;
+        }
+    }
+    if (used)
+        s->func(s->context, buffer, used);
+    STBIW_FREE(buffer);
+}
+
 static int stbiw__outfile(stbi__write_context* s, int rgb_dir, int vdir, int x, int y, int comp, int expand_mono, void* data, int alpha, int pad, const char* fmt, ...)
 {
     if (y < 0 || x < 0) {
@@ -786,7 +1080,7 @@ static int stbi_write_hdr_core(stbi__write_context* s, int x, int y, int comp, f
 #ifdef __STDC_LIB_EXT1__
         len = sprintf_s(buffer, sizeof(buffer), "EXPOSURE=          1.0000000000000\n\n-Y %d +X %d\n", y, x);
 #else
-        len = sprintf_s(buffer, "EXPOSURE=          1.0000000000000\n\n-Y %d +X %d\n", y, x);
+        len = sprintf(buffer, "EXPOSURE=          1.0000000000000\n\n-Y %d +X %d\n", y, x);
 #endif
         s->func(s->context, buffer, len);
 
@@ -904,35 +1198,43 @@ static unsigned int stbiw__zhash(unsigned char* data)
 
 #define stbiw__ZHASH   16384
 
-#endif // STBIW_ZLIB_COMPRESS
-
-STBIWDEF unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality)
+// Deflates data[begin, end) as one fixed-huffman block. Matches may reach back into
+// data before begin (up to the 32K window), so the positions there are inserted into
+// the hash table first. A final range ends the stream (BFINAL, padded to a byte); any
+// other range ends with a sync flush (an empty stored block), so it finishes on a byte
+// boundary and the ranges can simply be concatenated. Returns a stretchy buffer.
+static unsigned char* stbiw__zlib_deflate_range(unsigned char* data, int begin, int end, int quality, int final)
 {
-#ifdef STBIW_ZLIB_COMPRESS
-    // user provided a zlib compress implementation, use that
-    return STBIW_ZLIB_COMPRESS(data, data_len, out_len, quality);
-#else // use builtin
     static unsigned short lengthc[] = { 3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258, 259 };
     static unsigned char  lengtheb[] = { 0,0,0,0,0,0,0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,  4,  5,  5,  5,  5,  0 };
     static unsigned short distc[] = { 1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577, 32768 };
     static unsigned char  disteb[] = { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
     unsigned int bitbuf = 0;
     int i, j, bitcount = 0;
+    int data_len = end;
     unsigned char* out = NULL;
     unsigned char*** hash_table = (unsigned char***)STBIW_MALLOC(stbiw__ZHASH * sizeof(unsigned char**));
     if (hash_table == NULL)
         return NULL;
     if (quality < 5) quality = 5;
 
-    stbiw__sbpush(out, 0x78);   // DEFLATE 32K window
-    stbiw__sbpush(out, 0x5e);   // FLEVEL = 1
-    stbiw__zlib_add(1, 1);  // BFINAL = 1
+    stbiw__zlib_add(final ? 1 : 0, 1);  // BFINAL
     stbiw__zlib_add(1, 2);  // BTYPE = 1 -- fixed huffman
 
     for (i = 0; i < stbiw__ZHASH; ++i)
         hash_table[i] = NULL;
 
-    i = 0;
+    // prime the hash table with the window preceding this range
+    for (i = (begin > 32768 ? begin - 32768 : 0); i < begin && i < data_len - 3; ++i) {
+        int h = stbiw__zhash(data + i) & (stbiw__ZHASH - 1);
+        if (hash_table[h] && stbiw__sbn(hash_table[h]) == 2 * quality) {
+            STBIW_MEMMOVE(hash_table[h], hash_table[h] + quality, sizeof(hash_table[h][0]) * quality);
+            stbiw__sbn(hash_table[h]) = quality;
+        }
+        stbiw__sbpush(hash_table[h], data + i);
+    }
+
+    i = begin;
     while (i < data_len - 3) {
         // hash next 3 bytes of data to be compressed
         int h = stbiw__zhash(data + i) & (stbiw__ZHASH - 1), best = 3;
@@ -988,47 +1290,280 @@ STBIWDEF unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, in
     for (; i < data_len; ++i)
         stbiw__zlib_huffb(data[i]);
     stbiw__zlib_huff(256); // end of block
+    if (!final) {
+        // sync flush: empty stored block, BFINAL = 0, BTYPE = 0, LEN = 0, NLEN = 0xffff
+        stbiw__zlib_add(0, 3);
+    }
     // pad with 0 bits to byte boundary
     while (bitcount)
         stbiw__zlib_add(0, 1);
+    if (!final) {
+        stbiw__sbpush(out, 0);
+        stbiw__sbpush(out, 0);
+        stbiw__sbpush(out, 0xff);
+        stbiw__sbpush(out, 0xff);
+    }
 
     for (i = 0; i < stbiw__ZHASH; ++i)
         (void)stbiw__sbfree(hash_table[i]);
     STBIW_FREE(hash_table);
 
-    // store uncompressed instead if compression was worse
-    if (stbiw__sbn(out) > data_len + 2 + ((data_len + 32766) / 32767) * 5) {
-        stbiw__sbn(out) = 2;  // truncate to DEFLATE 32K window and FLEVEL = 1
-        for (j = 0; j < data_len;) {
-            int blocklen = data_len - j;
+    // store uncompressed instead if compression was worse (empty input keeps its empty fixed block)
+    if (end > begin && stbiw__sbn(out) > (end - begin) + ((end - begin + 32766) / 32767) * 5) {
+        stbiw__sbn(out) = 0;
+        for (j = begin; j < end;) {
+            int blocklen = end - j;
             if (blocklen > 32767) blocklen = 32767;
-            stbiw__sbpush(out, data_len - j == blocklen); // BFINAL = ?, BTYPE = 0 -- no compression
+            stbiw__sbpush(out, final && end - j == blocklen); // BFINAL = ?, BTYPE = 0 -- no compression
             stbiw__sbpush(out, STBIW_UCHAR(blocklen)); // LEN
             stbiw__sbpush(out, STBIW_UCHAR(blocklen >> 8));
             stbiw__sbpush(out, STBIW_UCHAR(~blocklen)); // NLEN
             stbiw__sbpush(out, STBIW_UCHAR(~blocklen >> 8));
+            stbiw__sbmaybegrow(out, blocklen);
             memcpy(out + stbiw__sbn(out), data + j, blocklen);
             stbiw__sbn(out) += blocklen;
             j += blocklen;
         }
     }
+    return out;
+}
 
-    {
-        // compute adler32 on input
-        unsigned int s1 = 1, s2 = 0;
-        int blocklen = (int)(data_len % 5552);
-        j = 0;
-        while (j < data_len) {
-            for (i = 0; i < blocklen; ++i) { s1 += data[j + i]; s2 += s1; }
-            s1 %= 65521; s2 %= 65521;
-            j += blocklen;
-            blocklen = 5552;
+static unsigned int stbiw__adler32_scalar(unsigned int adler, const unsigned char* data, int data_len)
+{
+    unsigned int s1 = adler & 0xffff, s2 = adler >> 16;
+    while (data_len > 0) {
+        // 5552 is the most bytes that can be summed before s2 may overflow
+        int i, blocklen = data_len < 5552 ? data_len : 5552;
+        for (i = 0; i < blocklen; ++i) { s1 += data[i]; s2 += s1; }
+        s1 %= 65521; s2 %= 65521;
+        data += blocklen;
+        data_len -= blocklen;
+    }
+    return (s2 << 16) | s1;
+}
+
+// The vectorized Adler32 kernels consume whole blocks and leave the tail to the scalar
+// loop. Per block of B bytes b[0..B): s2 += B * s1 + sum((B - k) * b[k]); s1 += sum(b[k]).
+// The B * s1 terms are collected in ps and added once per 5552-byte run.
+#ifdef STBIW__SSE2
+static unsigned int stbiw__adler32_sse2(unsigned int adler, const unsigned char* data, int* data_len)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights_lo = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+    const __m128i weights_hi = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+    unsigned int s1 = adler & 0xffff, s2 = adler >> 16;
+    int blocks = *data_len / 16;
+    *data_len -= blocks * 16;
+    while (blocks) {
+        int n = blocks < 5552 / 16 ? blocks : 5552 / 16;
+        __m128i v_s1 = zero, v_s2 = _mm_cvtsi32_si128((int)s2), v_ps = _mm_cvtsi32_si128((int)(s1 * n));
+        unsigned long long sum1, sum2;
+        blocks -= n;
+        do {
+            __m128i x = _mm_loadu_si128((const __m128i*)data);
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(x, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_unpacklo_epi8(x, zero), weights_lo));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_unpackhi_epi8(x, zero), weights_hi));
+            data += 16;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 4));
+        // the lanes are summed in 64 bits; each one fits in 32
+        sum1 = (unsigned int)_mm_cvtsi128_si32(v_s1) + (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(v_s1, 8));
+        sum2 = (unsigned long long)(unsigned int)_mm_cvtsi128_si32(v_s2) + (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(v_s2, 4))
+             + (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(v_s2, 8)) + (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(v_s2, 12));
+        s1 = (unsigned int)((s1 + sum1) % 65521);
+        s2 = (unsigned int)(sum2 % 65521);
+    }
+    return (s2 << 16) | s1;
+}
+#endif
+
+#ifdef STBIW__AVX2
+STBIW__TARGET_AVX2 static unsigned int stbiw__adler32_avx2(unsigned int adler, const unsigned char* data, int* data_len)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i weights = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                             16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    unsigned int s1 = adler & 0xffff, s2 = adler >> 16;
+    int blocks = *data_len / 32;
+    *data_len -= blocks * 32;
+    while (blocks) {
+        int i, n = blocks < 5552 / 32 ? blocks : 5552 / 32;
+        __m256i v_s1 = zero, v_s2 = _mm256_castsi128_si256(_mm_cvtsi32_si128((int)s2));
+        __m256i v_ps = _mm256_castsi128_si256(_mm_cvtsi32_si128((int)(s1 * n)));
+        unsigned int lanes[8];
+        unsigned long long sum1 = 0, sum2 = 0;
+        blocks -= n;
+        do {
+            __m256i x = _mm256_loadu_si256((const __m256i*)data);
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(x, zero));
+            // byte * weight pairs fit in 16 bits (2 * 255 * 32)
+            v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(_mm256_maddubs_epi16(x, weights), ones));
+            data += 32;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+        _mm256_storeu_si256((__m256i*)lanes, v_s1);
+        for (i = 0; i < 8; ++i) sum1 += lanes[i];
+        _mm256_storeu_si256((__m256i*)lanes, v_s2);
+        for (i = 0; i < 8; ++i) sum2 += lanes[i];
+        s1 = (unsigned int)((s1 + sum1) % 65521);
+        s2 = (unsigned int)(sum2 % 65521);
+    }
+    return (s2 << 16) | s1;
+}
+#endif
+
+#ifdef STBIW__NEON
+static unsigned int stbiw__adler32_neon(unsigned int adler, const unsigned char* data, int* data_len)
+{
+    static const unsigned char weights[16] = { 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1 };
+    const uint8x8_t weights_lo = vld1_u8(weights), weights_hi = vld1_u8(weights + 8);
+    unsigned int s1 = adler & 0xffff, s2 = adler >> 16;
+    int blocks = *data_len / 16;
+    *data_len -= blocks * 16;
+    while (blocks) {
+        int n = blocks < 5552 / 16 ? blocks : 5552 / 16;
+        uint32x4_t v_s1 = vdupq_n_u32(0), v_s2 = vsetq_lane_u32(s2, vdupq_n_u32(0), 0), v_ps = vsetq_lane_u32(s1 * n, vdupq_n_u32(0), 0);
+        unsigned long long sum1, sum2;
+        blocks -= n;
+        do {
+            uint8x16_t x = vld1q_u8(data);
+            v_ps = vaddq_u32(v_ps, v_s1);
+            v_s1 = vpadalq_u16(v_s1, vpaddlq_u8(x));
+            v_s2 = vpadalq_u16(v_s2, vmlal_u8(vmull_u8(vget_low_u8(x), weights_lo), vget_high_u8(x), weights_hi));
+            data += 16;
+        } while (--n);
+        v_s2 = vaddq_u32(v_s2, vshlq_n_u32(v_ps, 4));
+        sum1 = (unsigned long long)vgetq_lane_u32(v_s1, 0) + vgetq_lane_u32(v_s1, 1) + vgetq_lane_u32(v_s1, 2) + vgetq_lane_u32(v_s1, 3);
+        sum2 = (unsigned long long)vgetq_lane_u32(v_s2, 0) + vgetq_lane_u32(v_s2, 1) + vgetq_lane_u32(v_s2, 2) + vgetq_lane_u32(v_s2, 3);
+        s1 = (unsigned int)((s1 + sum1) % 65521);
+        s2 = (unsigned int)(sum2 % 65521);
+    }
+    return (s2 << 16) | s1;
+}
+#endif
+
+static unsigned int stbiw__adler32(unsigned char* data, int data_len)
+{
+    unsigned int adler = 1;
+    int simd_level = stbiw__simd_level(), tail = data_len;
+#ifdef STBIW__AVX2
+    if (simd_level >= STBIW__SIMD_AVX2)
+        adler = stbiw__adler32_avx2(adler, data, &tail);
+    else
+#endif
+#ifdef STBIW__SSE2
+    if (simd_level >= STBIW__SIMD_SSE2)
+        adler = stbiw__adler32_sse2(adler, data, &tail);
+#endif
+#ifdef STBIW__NEON
+    if (simd_level >= STBIW__SIMD_SSE2)
+        adler = stbiw__adler32_neon(adler, data, &tail);
+#endif
+    (void)simd_level;
+    return stbiw__adler32_scalar(adler, data + (data_len - tail), tail);
+}
+
+// adler32 of A followed by B, from adler32(A), adler32(B) and the length of B (as zlib's adler32_combine)
+static unsigned int stbiw__adler32_combine(unsigned int adler1, unsigned int adler2, int len2)
+{
+    unsigned int rem = (unsigned int)len2 % 65521;
+    unsigned int s1 = adler1 & 0xffff;
+    unsigned int s2 = (rem * s1) % 65521;
+    s1 += (adler2 & 0xffff) + 65521 - 1;
+    s2 += (adler1 >> 16) + (adler2 >> 16) + 65521 - rem;
+    if (s1 >= 65521) s1 -= 65521;
+    if (s1 >= 65521) s1 -= 65521;
+    if (s2 >= 65521 * 2) s2 -= 65521 * 2;
+    if (s2 >= 65521) s2 -= 65521;
+    return (s2 << 16) | s1;
+}
+
+// chunks of a parallel stbi_zlib_compress (or of one batch of the streaming PNG writer)
+typedef struct
+{
+    unsigned char* data;
+    int base;         // where the first chunk starts; the bytes before it are history for the window
+    int data_len;     // where the last chunk ends
+    int chunk_size;
+    int chunk_count;
+    int quality;
+    int final;        // whether the last chunk ends the stream
+    unsigned char** chunks;   // stretchy buffers
+    unsigned int* adlers;
+} stbiw__zlib_chunks;
+
+static void stbiw__zlib_deflate_chunk(void* context, int index)
+{
+    stbiw__zlib_chunks* c = (stbiw__zlib_chunks*)context;
+    int begin = c->base + index * c->chunk_size;
+    int end = (index == c->chunk_count - 1) ? c->data_len : begin + c->chunk_size;
+    c->chunks[index] = stbiw__zlib_deflate_range(c->data, begin, end, c->quality, c->final && index == c->chunk_count - 1);
+    c->adlers[index] = stbiw__adler32(c->data + begin, end - begin);
+}
+#endif // STBIW_ZLIB_COMPRESS
+
+STBIWDEF unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality)
+{
+#ifdef STBIW_ZLIB_COMPRESS
+    // user provided a zlib compress implementation, use that
+    return STBIW_ZLIB_COMPRESS(data, data_len, out_len, quality);
+#else // use builtin
+    stbiw__zlib_chunks c;
+    unsigned char* out = NULL;
+    unsigned int adler;
+    int i, failed = 0;
+
+    // without a parallel-for (or for small data) the whole input is a single range
+    c.chunk_size = (stbiw__parallel_for && stbi_write_zlib_chunk_size > 0) ? stbi_write_zlib_chunk_size : data_len;
+    if (c.chunk_size < 32768) c.chunk_size = 32768;
+    c.chunk_count = data_len > c.chunk_size ? (int)(((long long)data_len + c.chunk_size - 1) / c.chunk_size) : 1;
+    c.data = data;
+    c.base = 0;
+    c.data_len = data_len;
+    c.quality = quality;
+    c.final = 1;
+    c.chunks = (unsigned char**)STBIW_MALLOC(c.chunk_count * (sizeof(unsigned char*) + sizeof(unsigned int)));
+    if (c.chunks == NULL)
+        return NULL;
+    c.adlers = (unsigned int*)(c.chunks + c.chunk_count);
+
+    if (c.chunk_count > 1)
+        stbiw__parallel_for(stbiw__parallel_for_context, c.chunk_count, stbiw__zlib_deflate_chunk, &c);
+    else
+        stbiw__zlib_deflate_chunk(&c, 0);
+
+    stbiw__sbpush(out, 0x78);   // DEFLATE 32K window
+    stbiw__sbpush(out, 0x5e);   // FLEVEL = 1
+    adler = 1;
+    for (i = 0; i < c.chunk_count; ++i) {
+        int len = stbiw__sbcount(c.chunks[i]);
+        int begin = i * c.chunk_size;
+        if (c.chunks[i] == NULL) {
+            failed = 1;
+            continue;
         }
-        stbiw__sbpush(out, STBIW_UCHAR(s2 >> 8));
-        stbiw__sbpush(out, STBIW_UCHAR(s2));
-        stbiw__sbpush(out, STBIW_UCHAR(s1 >> 8));
-        stbiw__sbpush(out, STBIW_UCHAR(s1));
+        if (!failed) {
+            stbiw__sbmaybegrow(out, len);
+            memcpy(out + stbiw__sbn(out), c.chunks[i], len);
+            stbiw__sbn(out) += len;
+            adler = stbiw__adler32_combine(adler, c.adlers[i], (i == c.chunk_count - 1 ? data_len : begin + c.chunk_size) - begin);
+        }
+        (void)stbiw__sbfree(c.chunks[i]);
+    }
+    STBIW_FREE(c.chunks);
+    if (failed) {
+        (void)stbiw__sbfree(out);
+        return NULL;
     }
+
+    stbiw__sbpush(out, STBIW_UCHAR(adler >> 24));
+    stbiw__sbpush(out, STBIW_UCHAR(adler >> 16));
+    stbiw__sbpush(out, STBIW_UCHAR(adler >> 8));
+    stbiw__sbpush(out, STBIW_UCHAR(adler));
     *out_len = stbiw__sbn(out);
     // make returned pointer freeable
     STBIW_MEMMOVE(stbiw__sbraw(out), out, *out_len);
@@ -1036,52 +1571,174 @@ STBIWDEF unsigned char* stbi_zlib_compress(unsigned char* data, int data_len, in
 #endif // STBIW_ZLIB_COMPRESS
 }
 
+#ifndef STBIW_CRC32
+static const unsigned int stbiw__crc_table[256] =
+{
+   0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+   0x0eDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+   0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+   0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+   0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+   0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+   0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+   0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+   0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+   0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+   0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+   0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+   0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+   0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+   0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+   0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+   0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+   0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+   0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+   0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+   0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+   0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+   0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+   0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+   0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+   0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+   0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+   0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+   0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+   0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+   0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+   0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+};
+
+// The CRC functions below work on the raw register (stbiw__crc32 applies the initial
+// and final inversion), so they can be chained over consecutive pieces of a buffer.
+static unsigned int stbiw__crc32_bytes(unsigned int crc, const unsigned char* buffer, int len)
+{
+    int i;
+    for (i = 0; i < len; ++i)
+        crc = (crc >> 8) ^ stbiw__crc_table[buffer[i] ^ (crc & 0xff)];
+    return crc;
+}
+
+// slice-by-8: 8 bytes per step through 8 tables, where table k advances a byte through
+// k further zero bytes. The tables are derived from stbiw__crc_table on each call
+// (2K entries, cheap next to the image-sized buffers this is used for) so there is no
+// shared state to initialize across threads.
+static unsigned int stbiw__crc32_slice8(unsigned int crc, const unsigned char* buffer, int len)
+{
+    unsigned int t[8][256];
+    int i, k;
+    if (len < 1024)
+        return stbiw__crc32_bytes(crc, buffer, len);
+
+    for (i = 0; i < 256; ++i)
+        t[0][i] = stbiw__crc_table[i];
+    for (k = 1; k < 8; ++k)
+        for (i = 0; i < 256; ++i)
+            t[k][i] = (t[k - 1][i] >> 8) ^ stbiw__crc_table[t[k - 1][i] & 0xff];
+
+    for (; len >= 8; buffer += 8, len -= 8) {
+        unsigned int lo = crc ^ ((unsigned int)buffer[0] | ((unsigned int)buffer[1] << 8) | ((unsigned int)buffer[2] << 16) | ((unsigned int)buffer[3] << 24));
+        unsigned int hi = (unsigned int)buffer[4] | ((unsigned int)buffer[5] << 8) | ((unsigned int)buffer[6] << 16) | ((unsigned int)buffer[7] << 24);
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+    }
+    return stbiw__crc32_bytes(crc, buffer, len);
+}
+
+#ifdef STBIW__PCLMUL
+// Carry-less multiply folding (Intel, "Fast CRC Computation for Generic Polynomials
+// Using PCLMULQDQ"), with the constants for the reflected CRC-32 polynomial. Folds four
+// 128-bit lanes while 64 bytes remain, then one lane per 16 bytes, then reduces with
+// Barrett. len must be a multiple of 16 and at least 64.
+STBIW__TARGET_PCLMUL static unsigned int stbiw__crc32_pclmul(unsigned int crc, const unsigned char* buffer, int len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x0, x1, x2, x3, x4, x5;
+
+    x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buffer + 0x00)), _mm_cvtsi32_si128((int)crc));
+    x2 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+    buffer += 64;
+    len -= 64;
+
+    for (; len >= 64; buffer += 64, len -= 64) {
+        __m128i f1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x00), _mm_clmulepi64_si128(x1, k1k2, 0x11));
+        __m128i f2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x00), _mm_clmulepi64_si128(x2, k1k2, 0x11));
+        __m128i f3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x00), _mm_clmulepi64_si128(x3, k1k2, 0x11));
+        __m128i f4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x00), _mm_clmulepi64_si128(x4, k1k2, 0x11));
+        x1 = _mm_xor_si128(f1, _mm_loadu_si128((const __m128i*)(buffer + 0x00)));
+        x2 = _mm_xor_si128(f2, _mm_loadu_si128((const __m128i*)(buffer + 0x10)));
+        x3 = _mm_xor_si128(f3, _mm_loadu_si128((const __m128i*)(buffer + 0x20)));
+        x4 = _mm_xor_si128(f4, _mm_loadu_si128((const __m128i*)(buffer + 0x30)));
+    }
+
+    // fold the four lanes into one
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+    for (; len >= 16; buffer += 16, len -= 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_loadu_si128((const __m128i*)buffer)), x5);
+    }
+
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00), x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+    x0 = _mm_xor_si128(x1, x2);
+    return (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(x0, 4));
+}
+#endif
+
+#ifdef STBIW__ARM_CRC32
+static unsigned int stbiw__crc32_armv8(unsigned int crc, const unsigned char* buffer, int len)
+{
+    for (; len >= 8; buffer += 8, len -= 8) {
+        unsigned long long v;
+        memcpy(&v, buffer, 8);   // the CRC32 instructions take little-endian data, as ARM runs
+        crc = __crc32d(crc, v);
+    }
+    for (; len > 0; ++buffer, --len)
+        crc = __crc32b(crc, *buffer);
+    return crc;
+}
+#endif
+#endif // STBIW_CRC32
+
 static unsigned int stbiw__crc32(unsigned char* buffer, int len)
 {
 #ifdef STBIW_CRC32
     return STBIW_CRC32(buffer, len);
 #else
-    static unsigned int crc_table[256] =
-    {
-       0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-       0x0eDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-       0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-       0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-       0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-       0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-       0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-       0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-       0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-       0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-       0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-       0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-       0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-       0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-       0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-       0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-       0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-       0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-       0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-       0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-       0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-       0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-       0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-       0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-       0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-       0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-       0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-       0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-       0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-       0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-       0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-       0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-    };
-
     unsigned int crc = ~0u;
-    int i;
-    for (i = 0; i < len; ++i)
-        crc = (crc >> 8) ^ crc_table[buffer[i] ^ (crc & 0xff)];
-    return ~crc;
+    int simd_level = stbiw__simd_level();
+#ifdef STBIW__PCLMUL
+    if (simd_level >= STBIW__SIMD_SSE2 && len >= 64 && stbiw__cpu_has_pclmul()) {
+        int n = len & ~15;
+        crc = stbiw__crc32_pclmul(crc, buffer, n);
+        buffer += n;
+        len -= n;
+    }
+#endif
+#ifdef STBIW__ARM_CRC32
+    if (simd_level >= STBIW__SIMD_SSE2)
+        return ~stbiw__crc32_armv8(crc, buffer, len);
+#endif
+    (void)simd_level;
+    return ~stbiw__crc32_slice8(crc, buffer, len);
 #endif
 }
 
@@ -1103,53 +1760,309 @@ static unsigned char stbiw__paeth(int a, int b, int c)
     return STBIW_UCHAR(c);
 }
 
-// @OPTIMIZE: provide an option that always forces left-predict or paeth predict
-static void stbiw__encode_png_line(unsigned char* pixels, int stride_bytes, int width, int height, int y, int n, int filter_type, signed char* line_buffer)
+// SIMD versions of the filters in stbiw__encode_png_line. Each one filters bytes
+// [n, len) of the row z (prev is the row above, only read by types 2..4) and
+// returns the index where the scalar loop has to take over.
+#ifdef STBIW__SSE2
+static __m128i stbiw__paeth_sse2(__m128i a, __m128i b, __m128i c)
 {
-    static int mapping[] = { 0,1,2,3,4 };
-    static int firstmap[] = { 0,1,0,5,6 };
-    int* mymap = (y != 0) ? mapping : firstmap;
-    int i;
-    int type = mymap[filter_type];
-    unsigned char* z = pixels + stride_bytes * (stbi__flip_vertically_on_write ? height - 1 - y : y);
-    int signed_stride = stbi__flip_vertically_on_write ? -stride_bytes : stride_bytes;
-
-    if (type == 0) {
-        memcpy(line_buffer, z, width * n);
-        return;
+    // same decision as stbiw__paeth, done in 16-bit lanes:
+    // pa = |b-c|, pb = |a-c|, pc = |a+b-2c|
+    __m128i zero = _mm_setzero_si128();
+    __m128i pred[2];
+    int h;
+    for (h = 0; h < 2; ++h) {
+        __m128i a16 = h ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+        __m128i b16 = h ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+        __m128i c16 = h ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+        __m128i dbc = _mm_sub_epi16(b16, c16);
+        __m128i dac = _mm_sub_epi16(a16, c16);
+        __m128i sum = _mm_add_epi16(dbc, dac);
+        __m128i pa = _mm_max_epi16(dbc, _mm_sub_epi16(zero, dbc));
+        __m128i pb = _mm_max_epi16(dac, _mm_sub_epi16(zero, dac));
+        __m128i pc = _mm_max_epi16(sum, _mm_sub_epi16(zero, sum));
+        __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+        __m128i use_c = _mm_cmpgt_epi16(pb, pc);
+        __m128i b_or_c = _mm_or_si128(_mm_and_si128(use_c, c16), _mm_andnot_si128(use_c, b16));
+        pred[h] = _mm_or_si128(_mm_and_si128(not_a, b_or_c), _mm_andnot_si128(not_a, a16));
     }
+    return _mm_packus_epi16(pred[0], pred[1]);
+}
 
-    // first loop isn't optimized since it's just one pixel
-    for (i = 0; i < n; ++i) {
+static int stbiw__filter_row_sse2(int type, const unsigned char* z, const unsigned char* prev, int n, int len, signed char* out)
+{
+    __m128i one = _mm_set1_epi8(1), low7 = _mm_set1_epi8(0x7f);
+    int i;
+    for (i = n; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(z + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(z + i - n));
+        __m128i p;
         switch (type) {
-        case 1: line_buffer[i] = z[i]; break;
-        case 2: line_buffer[i] = z[i] - z[i - signed_stride]; break;
-        case 3: line_buffer[i] = z[i] - (z[i - signed_stride] >> 1); break;
-        case 4: line_buffer[i] = (signed char)(z[i] - stbiw__paeth(0, z[i - signed_stride], 0)); break;
-        case 5: line_buffer[i] = z[i]; break;
-        case 6: line_buffer[i] = z[i]; break;
+        case 2: p = _mm_loadu_si128((const __m128i*)(prev + i)); break;
+        case 3: {
+            __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+            // floor((a+b)/2): _mm_avg_epu8 rounds up, so take the odd bit back off
+            p = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            break;
         }
+        case 4: p = stbiw__paeth_sse2(a, _mm_loadu_si128((const __m128i*)(prev + i)), _mm_loadu_si128((const __m128i*)(prev + i - n))); break;
+        case 5: p = _mm_and_si128(_mm_srli_epi16(a, 1), low7); break;
+        default: p = a; break;   // 1, and 6 (paeth with no row above is always the left pixel)
+        }
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi8(x, p));
     }
-    switch (type) {
-    case 1: for (i = n; i < width * n; ++i) line_buffer[i] = z[i] - z[i - n]; break;
-    case 2: for (i = n; i < width * n; ++i) line_buffer[i] = z[i] - z[i - signed_stride]; break;
-    case 3: for (i = n; i < width * n; ++i) line_buffer[i] = z[i] - ((z[i - n] + z[i - signed_stride]) >> 1); break;
-    case 4: for (i = n; i < width * n; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i - n], z[i - signed_stride], z[i - signed_stride - n]); break;
-    case 5: for (i = n; i < width * n; ++i) line_buffer[i] = z[i] - (z[i - n] >> 1); break;
-    case 6: for (i = n; i < width * n; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i - n], 0, 0); break;
-    }
+    return i;
 }
 
-STBIWDEF unsigned char* stbi_write_png_to_mem(const unsigned char* pixels, int stride_bytes, int x, int y, int n, int* out_len)
+static int stbiw__line_cost_sse2(const signed char* line, int len, int* cost)
 {
-    int force_filter = stbi_write_force_png_filter;
-    int ctype[5] = { -1, 0, 4, 2, 6 };
-    unsigned char sig[8] = { 137,80,78,71,13,10,26,10 };
-    unsigned char* out, * o, * filt, * zlib;
-    signed char* line_buffer;
-    int j, zlen;
+    __m128i zero = _mm_setzero_si128(), acc = _mm_setzero_si128();
+    int i;
+    for (i = 0; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(line + i));
+        __m128i sign = _mm_cmpgt_epi8(zero, x);
+        __m128i abs8 = _mm_sub_epi8(_mm_xor_si128(x, sign), sign);   // |-128| wraps to 0x80, which is 128 unsigned
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(abs8, zero));
+    }
+    *cost = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+    return i;
+}
+#endif
 
-    if (stride_bytes == 0)
+#ifdef STBIW__AVX2
+STBIW__TARGET_AVX2 static __m256i stbiw__paeth_avx2(__m256i a, __m256i b, __m256i c)
+{
+    // unpack/pack work within each 128-bit lane, so the round trip keeps byte order
+    __m256i zero = _mm256_setzero_si256();
+    __m256i pred[2];
+    int h;
+    for (h = 0; h < 2; ++h) {
+        __m256i a16 = h ? _mm256_unpackhi_epi8(a, zero) : _mm256_unpacklo_epi8(a, zero);
+        __m256i b16 = h ? _mm256_unpackhi_epi8(b, zero) : _mm256_unpacklo_epi8(b, zero);
+        __m256i c16 = h ? _mm256_unpackhi_epi8(c, zero) : _mm256_unpacklo_epi8(c, zero);
+        __m256i dbc = _mm256_sub_epi16(b16, c16);
+        __m256i dac = _mm256_sub_epi16(a16, c16);
+        __m256i pa = _mm256_abs_epi16(dbc);
+        __m256i pb = _mm256_abs_epi16(dac);
+        __m256i pc = _mm256_abs_epi16(_mm256_add_epi16(dbc, dac));
+        __m256i not_a = _mm256_or_si256(_mm256_cmpgt_epi16(pa, pb), _mm256_cmpgt_epi16(pa, pc));
+        __m256i b_or_c = _mm256_blendv_epi8(b16, c16, _mm256_cmpgt_epi16(pb, pc));
+        pred[h] = _mm256_blendv_epi8(a16, b_or_c, not_a);
+    }
+    return _mm256_packus_epi16(pred[0], pred[1]);
+}
+
+STBIW__TARGET_AVX2 static int stbiw__filter_row_avx2(int type, const unsigned char* z, const unsigned char* prev, int n, int len, signed char* out)
+{
+    __m256i one = _mm256_set1_epi8(1), low7 = _mm256_set1_epi8(0x7f);
+    int i;
+    for (i = n; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(z + i));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(z + i - n));
+        __m256i p;
+        switch (type) {
+        case 2: p = _mm256_loadu_si256((const __m256i*)(prev + i)); break;
+        case 3: {
+            __m256i b = _mm256_loadu_si256((const __m256i*)(prev + i));
+            p = _mm256_sub_epi8(_mm256_avg_epu8(a, b), _mm256_and_si256(_mm256_xor_si256(a, b), one));
+            break;
+        }
+        case 4: p = stbiw__paeth_avx2(a, _mm256_loadu_si256((const __m256i*)(prev + i)), _mm256_loadu_si256((const __m256i*)(prev + i - n))); break;
+        case 5: p = _mm256_and_si256(_mm256_srli_epi16(a, 1), low7); break;
+        default: p = a; break;
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sub_epi8(x, p));
+    }
+    return i;
+}
+
+STBIW__TARGET_AVX2 static int stbiw__line_cost_avx2(const signed char* line, int len, int* cost)
+{
+    __m256i zero = _mm256_setzero_si256(), acc = _mm256_setzero_si256();
+    __m128i sum;
+    int i;
+    for (i = 0; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(line + i));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_abs_epi8(x), zero));
+    }
+    sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    *cost = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    return i;
+}
+#endif
+
+#ifdef STBIW__NEON
+static uint8x16_t stbiw__paeth_neon(uint8x16_t a, uint8x16_t b, uint8x16_t c)
+{
+    uint8x8_t half[2];
+    int h;
+    for (h = 0; h < 2; ++h) {
+        int16x8_t a16 = vreinterpretq_s16_u16(vmovl_u8(h ? vget_high_u8(a) : vget_low_u8(a)));
+        int16x8_t b16 = vreinterpretq_s16_u16(vmovl_u8(h ? vget_high_u8(b) : vget_low_u8(b)));
+        int16x8_t c16 = vreinterpretq_s16_u16(vmovl_u8(h ? vget_high_u8(c) : vget_low_u8(c)));
+        int16x8_t dbc = vsubq_s16(b16, c16);
+        int16x8_t dac = vsubq_s16(a16, c16);
+        int16x8_t pa = vabsq_s16(dbc);
+        int16x8_t pb = vabsq_s16(dac);
+        int16x8_t pc = vabsq_s16(vaddq_s16(dbc, dac));
+        uint16x8_t not_a = vorrq_u16(vcgtq_s16(pa, pb), vcgtq_s16(pa, pc));
+        int16x8_t b_or_c = vbslq_s16(vcgtq_s16(pb, pc), c16, b16);
+        half[h] = vmovn_u16(vreinterpretq_u16_s16(vbslq_s16(not_a, b_or_c, a16)));
+    }
+    return vcombine_u8(half[0], half[1]);
+}
+
+static int stbiw__filter_row_neon(int type, const unsigned char* z, const unsigned char* prev, int n, int len, signed char* out)
+{
+    int i;
+    for (i = n; i + 16 <= len; i += 16) {
+        uint8x16_t x = vld1q_u8(z + i);
+        uint8x16_t a = vld1q_u8(z + i - n);
+        uint8x16_t p;
+        switch (type) {
+        case 2: p = vld1q_u8(prev + i); break;
+        case 3: p = vhaddq_u8(a, vld1q_u8(prev + i)); break;   // halving add is exactly (a+b)>>1
+        case 4: p = stbiw__paeth_neon(a, vld1q_u8(prev + i), vld1q_u8(prev + i - n)); break;
+        case 5: p = vshrq_n_u8(a, 1); break;
+        default: p = a; break;
+        }
+        vst1q_s8(out + i, vreinterpretq_s8_u8(vsubq_u8(x, p)));
+    }
+    return i;
+}
+
+static int stbiw__line_cost_neon(const signed char* line, int len, int* cost)
+{
+    uint32x4_t acc = vdupq_n_u32(0);
+    int i;
+    for (i = 0; i + 16 <= len; i += 16) {
+        uint8x16_t abs8 = vreinterpretq_u8_s8(vabsq_s8(vld1q_s8(line + i)));   // |-128| stays 0x80, which is 128 unsigned
+        acc = vpadalq_u16(acc, vpaddlq_u8(abs8));
+    }
+    *cost = (int)(vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3));
+    return i;
+}
+#endif
+
+static int stbiw__filter_row_simd(int simd_level, int type, const unsigned char* z, const unsigned char* prev, int n, int len, signed char* out)
+{
+#ifdef STBIW__AVX2
+    if (simd_level >= STBIW__SIMD_AVX2)
+        return stbiw__filter_row_avx2(type, z, prev, n, len, out);
+#endif
+#ifdef STBIW__SSE2
+    if (simd_level >= STBIW__SIMD_SSE2)
+        return stbiw__filter_row_sse2(type, z, prev, n, len, out);
+#endif
+#ifdef STBIW__NEON
+    if (simd_level >= STBIW__SIMD_SSE2)
+        return stbiw__filter_row_neon(type, z, prev, n, len, out);
+#endif
+    (void)simd_level; (void)type; (void)z; (void)prev; (void)len; (void)out;
+    return n;
+}
+
+// Estimate the entropy of a filtered line as the sum of |byte|; the less, the better.
+static int stbiw__png_line_cost(int simd_level, const signed char* line, int len)
+{
+    int cost = 0, i = 0;
+#ifdef STBIW__AVX2
+    if (simd_level >= STBIW__SIMD_AVX2)
+        i = stbiw__line_cost_avx2(line, len, &cost);
+    else
+#endif
+#ifdef STBIW__SSE2
+    if (simd_level >= STBIW__SIMD_SSE2)
+        i = stbiw__line_cost_sse2(line, len, &cost);
+#endif
+#ifdef STBIW__NEON
+    if (simd_level >= STBIW__SIMD_SSE2)
+        i = stbiw__line_cost_neon(line, len, &cost);
+#endif
+    (void)simd_level;
+    for (; i < len; ++i)
+        cost += abs(line[i]);
+    return cost;
+}
+
+// @OPTIMIZE: provide an option that always forces left-predict or paeth predict
+static void stbiw__encode_png_line(unsigned char* pixels, int stride_bytes, int width, int height, int y, int n, int filter_type, signed char* line_buffer, int simd_level)
+{
+    static int mapping[] = { 0,1,2,3,4 };
+    static int firstmap[] = { 0,1,0,5,6 };
+    int* mymap = (y != 0) ? mapping : firstmap;
+    int i;
+    int type = mymap[filter_type];
+    unsigned char* z = pixels + stride_bytes * (stbi__flip_vertically_on_write ? height - 1 - y : y);
+    int signed_stride = stbi__flip_vertically_on_write ? -stride_bytes : stride_bytes;
+
+    if (type == 0) {
+        memcpy(line_buffer, z, width * n);
+        return;
+    }
+
+    // first loop isn't optimized since it's just one pixel
+    for (i = 0; i < n; ++i) {
+        switch (type) {
+        case 1: line_buffer[i] = z[i]; break;
+        case 2: line_buffer[i] = z[i] - z[i - signed_stride]; break;
+        case 3: line_buffer[i] = z[i] - (z[i - signed_stride] >> 1); break;
+        case 4: line_buffer[i] = (signed char)(z[i] - stbiw__paeth(0, z[i - signed_stride], 0)); break;
+        case 5: line_buffer[i] = z[i]; break;
+        case 6: line_buffer[i] = z[i]; break;
+        }
+    }
+    // the SIMD kernels do the bulk of the row, the scalar loops finish the tail
+    i = stbiw__filter_row_simd(simd_level, type, z, (y != 0) ? z - signed_stride : NULL, n, width * n, line_buffer);
+    switch (type) {
+    case 1: for (; i < width * n; ++i) line_buffer[i] = z[i] - z[i - n]; break;
+    case 2: for (; i < width * n; ++i) line_buffer[i] = z[i] - z[i - signed_stride]; break;
+    case 3: for (; i < width * n; ++i) line_buffer[i] = z[i] - ((z[i - n] + z[i - signed_stride]) >> 1); break;
+    case 4: for (; i < width * n; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i - n], z[i - signed_stride], z[i - signed_stride - n]); break;
+    case 5: for (; i < width * n; ++i) line_buffer[i] = z[i] - (z[i - n] >> 1); break;
+    case 6: for (; i < width * n; ++i) line_buffer[i] = z[i] - stbiw__paeth(z[i - n], 0, 0); break;
+    }
+}
+
+// Filter row j with force_filter, or with the filter whose output looks cheapest; returns the filter type
+// and leaves the filtered row in line_buffer
+static int stbiw__png_filter_row(const unsigned char* pixels, int stride_bytes, int x, int y, int j, int n, int force_filter, signed char* line_buffer, int simd_level)
+{
+    int filter_type;
+    if (force_filter > -1) {
+        filter_type = force_filter;
+        stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, force_filter, line_buffer, simd_level);
+    }
+    else { // Estimate the best filter by running through all of them:
+        int best_filter = 0, best_filter_val = 0x7fffffff, est;
+        for (filter_type = 0; filter_type < 5; filter_type++) {
+            stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, filter_type, line_buffer, simd_level);
+
+            est = stbiw__png_line_cost(simd_level, line_buffer, x * n);
+            if (est < best_filter_val) {
+                best_filter_val = est;
+                best_filter = filter_type;
+            }
+        }
+        if (filter_type != best_filter) {  // If the last iteration already got us the best filter, don't redo it
+            stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, best_filter, line_buffer, simd_level);
+            filter_type = best_filter;
+        }
+    }
+    return filter_type;
+}
+
+STBIWDEF unsigned char* stbi_write_png_to_mem(const unsigned char* pixels, int stride_bytes, int x, int y, int n, int* out_len)
+{
+    int force_filter = stbi_write_force_png_filter;
+    int simd_level = stbiw__simd_level();
+    int ctype[5] = { -1, 0, 4, 2, 6 };
+    unsigned char sig[8] = { 137,80,78,71,13,10,26,10 };
+    unsigned char* out, * o, * filt, * zlib;
+    signed char* line_buffer;
+    int j, zlen;
+
+    if (stride_bytes == 0)
         stride_bytes = x * n;
 
     if (force_filter >= 5) {
@@ -1159,32 +2072,7 @@ STBIWDEF unsigned char* stbi_write_png_to_mem(const unsigned char* pixels, int s
     filt = (unsigned char*)STBIW_MALLOC((x * n + 1) * y); if (!filt) return 0;
     line_buffer = (signed char*)STBIW_MALLOC(x * n); if (!line_buffer) { STBIW_FREE(filt); return 0; }
     for (j = 0; j < y; ++j) {
-        int filter_type;
-        if (force_filter > -1) {
-            filter_type = force_filter;
-            stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, force_filter, line_buffer);
-        }
-        else { // Estimate the best filter by running through all of them:
-            int best_filter = 0, best_filter_val = 0x7fffffff, est, i;
-            for (filter_type = 0; filter_type < 5; filter_type++) {
-                stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, filter_type, line_buffer);
-
-                // Estimate the entropy of the line using this filter; the less, the better.
-                est = 0;
-                for (i = 0; i < x * n; ++i) {
-                    est += abs((signed char)line_buffer[i]);
-                }
-                if (est < best_filter_val) {
-                    best_filter_val = est;
-                    best_filter = filter_type;
-                }
-            }
-            if (filter_type != best_filter) {  // If the last iteration already got us the best filter, don't redo it
-                stbiw__encode_png_line((unsigned char*)(pixels), stride_bytes, x, y, j, n, best_filter, line_buffer);
-                filter_type = best_filter;
-            }
-        }
-        // when we get here, filter_type contains the filter type, and line_buffer contains the data
+        int filter_type = stbiw__png_filter_row(pixels, stride_bytes, x, y, j, n, force_filter, line_buffer, simd_level);
         filt[j * (x * n + 1)] = (unsigned char)filter_type;
         STBIW_MEMMOVE(filt + j * (x * n + 1) + 1, line_buffer, x * n);
     }
@@ -1227,10 +2115,176 @@ STBIWDEF unsigned char* stbi_write_png_to_mem(const unsigned char* pixels, int s
     return out;
 }
 
+#ifndef STBIW_ZLIB_COMPRESS
+#ifndef STBIW_PNG_STREAM_CHUNKS
+#define STBIW_PNG_STREAM_CHUNKS 8   // deflate chunks per batch of the streaming PNG writer when a parallel-for is installed
+#endif
+
+// the output side of the streaming PNG writer
+typedef struct
+{
+    stbi_write_func* func;
+    void* context;
+    int first;            // the zlib header hasn't been written yet
+    unsigned int adler;   // of all the filtered bytes so far
+} stbiw__png_stream;
+
+// Write deflated data as one IDAT chunk, with the zlib header in front of the first one and the Adler-32 after the last
+static int stbiw__png_write_idat(stbiw__png_stream* p, const unsigned char* zdata, int zlen, int last)
+{
+    int len = zlen + (p->first ? 2 : 0) + (last ? 4 : 0);
+    unsigned char* chunk = (unsigned char*)STBIW_MALLOC(len + 12);
+    unsigned char* o = chunk;
+    if (chunk == NULL)
+        return 0;
+    stbiw__wp32(o, len);
+    stbiw__wptag(o, "IDAT");
+    if (p->first) {
+        *o++ = 0x78;   // DEFLATE 32K window
+        *o++ = 0x5e;   // FLEVEL = 1
+        p->first = 0;
+    }
+    if (zlen > 0) {
+        STBIW_MEMMOVE(o, zdata, zlen);
+        o += zlen;
+    }
+    if (last) {
+        stbiw__wp32(o, p->adler);
+    }
+    stbiw__wpcrc(&o, len);
+    p->func(p->context, chunk, len + 12);
+    STBIW_FREE(chunk);
+    return 1;
+}
+
+// Deflate window[begin, end) in chunks of chunk_size, concurrently if a parallel-for is installed, and write
+// each chunk out as an IDAT. These are exactly the chunks stbi_zlib_compress would make of the same bytes.
+static int stbiw__png_deflate_batch(stbiw__png_stream* p, unsigned char* window, int begin, int end, int chunk_size, int quality, int final)
+{
+    stbiw__zlib_chunks c;
+    int i, ok = 1;
+
+    c.data = window;
+    c.base = begin;
+    c.data_len = end;
+    c.chunk_size = chunk_size;
+    c.chunk_count = end > begin ? (end - begin + chunk_size - 1) / chunk_size : 1;
+    c.quality = quality;
+    c.final = final;
+    c.chunks = (unsigned char**)STBIW_MALLOC(c.chunk_count * (sizeof(unsigned char*) + sizeof(unsigned int)));
+    if (c.chunks == NULL)
+        return 0;
+    c.adlers = (unsigned int*)(c.chunks + c.chunk_count);
+
+    if (c.chunk_count > 1 && stbiw__parallel_for)
+        stbiw__parallel_for(stbiw__parallel_for_context, c.chunk_count, stbiw__zlib_deflate_chunk, &c);
+    else
+        for (i = 0; i < c.chunk_count; ++i)
+            stbiw__zlib_deflate_chunk(&c, i);
+
+    for (i = 0; i < c.chunk_count; ++i) {
+        int chunk_begin = begin + i * chunk_size;
+        int chunk_end = i == c.chunk_count - 1 ? end : chunk_begin + chunk_size;
+        if (c.chunks[i] == NULL)
+            ok = 0;
+        if (ok) {
+            p->adler = stbiw__adler32_combine(p->adler, c.adlers[i], chunk_end - chunk_begin);
+            ok = stbiw__png_write_idat(p, c.chunks[i], stbiw__sbn(c.chunks[i]), final && i == c.chunk_count - 1);
+        }
+        (void)stbiw__sbfree(c.chunks[i]);
+    }
+    STBIW_FREE(c.chunks);
+    return ok;
+}
+
+// Write a PNG through func a batch of rows at a time. The filtered rows go into a window that also keeps the
+// 32K of history the deflate may refer back to; whenever a whole batch of deflate chunks is ready it is
+// compressed, written as IDAT chunks and dropped. Memory is the window (32K, one batch and a row) however
+// tall the image is.
+static int stbiw__write_png_stream(stbi_write_func* func, void* context, const unsigned char* pixels, int stride_bytes, int x, int y, int n)
+{
+    int force_filter = stbi_write_force_png_filter;
+    int simd_level = stbiw__simd_level();
+    int ctype[5] = { -1, 0, 4, 2, 6 };
+    unsigned char sig[8] = { 137,80,78,71,13,10,26,10 };
+    unsigned char head[8 + 12 + 13], tail[12];
+    unsigned char* o, * window;
+    int row_len = x * n + 1, chunk_size, batch_size, history = 0, filled = 0, j, ok = 1;
+    stbiw__png_stream p;
+
+    if (stride_bytes == 0)
+        stride_bytes = x * n;
+
+    if (force_filter >= 5) {
+        force_filter = -1;
+    }
+
+    chunk_size = stbi_write_zlib_chunk_size > 32768 ? stbi_write_zlib_chunk_size : 32768;
+    batch_size = chunk_size * (stbiw__parallel_for ? STBIW_PNG_STREAM_CHUNKS : 1);
+    window = (unsigned char*)STBIW_MALLOC(32768 + batch_size + row_len);
+    if (window == NULL)
+        return 0;
+
+    o = head;
+    STBIW_MEMMOVE(o, sig, 8); o += 8;
+    stbiw__wp32(o, 13); // header length
+    stbiw__wptag(o, "IHDR");
+    stbiw__wp32(o, x);
+    stbiw__wp32(o, y);
+    *o++ = 8;
+    *o++ = STBIW_UCHAR(ctype[n]);
+    *o++ = 0;
+    *o++ = 0;
+    *o++ = 0;
+    stbiw__wpcrc(&o, 13);
+    func(context, head, sizeof(head));
+
+    p.func = func;
+    p.context = context;
+    p.first = 1;
+    p.adler = 1;
+
+    for (j = 0; j < y && ok; ++j) {
+        window[filled] = (unsigned char)stbiw__png_filter_row(pixels, stride_bytes, x, y, j, n, force_filter, (signed char*)window + filled + 1, simd_level);
+        filled += row_len;
+
+        // a batch is only deflated once there is data after it, so the final chunk is never empty
+        while (ok && filled - history > batch_size) {
+            int done = history + batch_size;
+            int keep = done < 32768 ? done : 32768;
+            ok = stbiw__png_deflate_batch(&p, window, history, done, chunk_size, stbi_write_png_compression_level, 0);
+            STBIW_MEMMOVE(window, window + done - keep, filled - (done - keep));
+            filled -= done - keep;
+            history = keep;
+        }
+    }
+    if (ok)
+        ok = stbiw__png_deflate_batch(&p, window, history, filled, chunk_size, stbi_write_png_compression_level, 1);
+    STBIW_FREE(window);
+    if (!ok)
+        return 0;
+
+    o = tail;
+    stbiw__wp32(o, 0);
+    stbiw__wptag(o, "IEND");
+    stbiw__wpcrc(&o, 0);
+    func(context, tail, sizeof(tail));
+    return 1;
+}
+#endif // STBIW_ZLIB_COMPRESS
+
 #ifndef STBI_WRITE_NO_STDIO
 STBIWDEF int stbi_write_png(char const* filename, int x, int y, int comp, const void* data, int stride_bytes)
 {
     FILE* f;
+#ifndef STBIW_ZLIB_COMPRESS
+    int r;
+    f = stbiw__fopen(filename, "wb");
+    if (!f) return 0;
+    r = stbiw__write_png_stream(stbi__stdio_write, f, (const unsigned char*)data, stride_bytes, x, y, comp);
+    fclose(f);
+    return r;
+#else
     int len;
     unsigned char* png = stbi_write_png_to_mem((const unsigned char*)data, stride_bytes, x, y, comp, &len);
     if (png == NULL) return 0;
@@ -1241,17 +2295,22 @@ STBIWDEF int stbi_write_png(char const* filename, int x, int y, int comp, const
     fclose(f);
     STBIW_FREE(png);
     return 1;
+#endif
 }
 #endif
 
 STBIWDEF int stbi_write_png_to_func(stbi_write_func* func, void* context, int x, int y, int comp, const void* data, int stride_bytes)
 {
+#ifndef STBIW_ZLIB_COMPRESS
+    return stbiw__write_png_stream(func, context, (const unsigned char*)data, stride_bytes, x, y, comp);
+#else
     int len;
     unsigned char* png = stbi_write_png_to_mem((const unsigned char*)data, stride_bytes, x, y, comp, &len);
     if (png == NULL) return 0;
     func(context, png, len);
     STBIW_FREE(png);
     return 1;
+#endif
 }
 
 
@@ -1341,11 +2400,338 @@ static void stbiw__jpg_calcBits(int val, unsigned short bits[2]) {
     bits[0] = val & ((1 << bits[1]) - 1);
 }
 
-static int stbiw__jpg_processDU(stbi__write_context* s, int* bitBuf, int* bitCnt, float* CDU, int du_stride, float* fdtbl, int DC, const unsigned short HTDC[256][2], const unsigned short HTAC[256][2]) {
-    const unsigned short EOB[2] = { HTAC[0x00][0], HTAC[0x00][1] };
-    const unsigned short M16zeroes[2] = { HTAC[0xF0][0], HTAC[0xF0][1] };
-    int dataOff, i, j, n, diff, end0pos, x, y;
-    int DU[64];
+// SIMD versions of the 8x8 forward DCT, the quantization and the RGB->YCbCr conversion. They
+// perform the same float operations in the same order as the scalar code, so the coefficients
+// only differ where the compiler contracts a multiply-add into an FMA for one path but not the other.
+#ifdef STBIW__SSE2
+#define STBIW__JPG_DCT_SSE2(d) do { \
+    __m128 tmp0 = _mm_add_ps(d[0], d[7]), tmp7 = _mm_sub_ps(d[0], d[7]); \
+    __m128 tmp1 = _mm_add_ps(d[1], d[6]), tmp6 = _mm_sub_ps(d[1], d[6]); \
+    __m128 tmp2 = _mm_add_ps(d[2], d[5]), tmp5 = _mm_sub_ps(d[2], d[5]); \
+    __m128 tmp3 = _mm_add_ps(d[3], d[4]), tmp4 = _mm_sub_ps(d[3], d[4]); \
+    __m128 tmp10 = _mm_add_ps(tmp0, tmp3), tmp13 = _mm_sub_ps(tmp0, tmp3); \
+    __m128 tmp11 = _mm_add_ps(tmp1, tmp2), tmp12 = _mm_sub_ps(tmp1, tmp2); \
+    __m128 z1, z2, z3, z4, z5, z11, z13; \
+    d[0] = _mm_add_ps(tmp10, tmp11); \
+    d[4] = _mm_sub_ps(tmp10, tmp11); \
+    z1 = _mm_mul_ps(_mm_add_ps(tmp12, tmp13), _mm_set1_ps(0.707106781f)); \
+    d[2] = _mm_add_ps(tmp13, z1); \
+    d[6] = _mm_sub_ps(tmp13, z1); \
+    tmp10 = _mm_add_ps(tmp4, tmp5); \
+    tmp11 = _mm_add_ps(tmp5, tmp6); \
+    tmp12 = _mm_add_ps(tmp6, tmp7); \
+    z5 = _mm_mul_ps(_mm_sub_ps(tmp10, tmp12), _mm_set1_ps(0.382683433f)); \
+    z2 = _mm_add_ps(_mm_mul_ps(tmp10, _mm_set1_ps(0.541196100f)), z5); \
+    z4 = _mm_add_ps(_mm_mul_ps(tmp12, _mm_set1_ps(1.306562965f)), z5); \
+    z3 = _mm_mul_ps(tmp11, _mm_set1_ps(0.707106781f)); \
+    z11 = _mm_add_ps(tmp7, z3); \
+    z13 = _mm_sub_ps(tmp7, z3); \
+    d[5] = _mm_add_ps(z13, z2); \
+    d[3] = _mm_sub_ps(z13, z2); \
+    d[1] = _mm_add_ps(z11, z4); \
+    d[7] = _mm_sub_ps(z11, z4); \
+} while (0)
+
+// transposes the 8x8 block held as left (columns 0-3) and right (columns 4-7) halves of each row
+static void stbiw__jpg_transpose_sse2(__m128* l, __m128* r)
+{
+    __m128 t;
+    _MM_TRANSPOSE4_PS(l[0], l[1], l[2], l[3]);
+    _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+    _MM_TRANSPOSE4_PS(l[4], l[5], l[6], l[7]);
+    _MM_TRANSPOSE4_PS(r[4], r[5], r[6], r[7]);
+    t = r[0]; r[0] = l[4]; l[4] = t;
+    t = r[1]; r[1] = l[5]; l[5] = t;
+    t = r[2]; r[2] = l[6]; l[6] = t;
+    t = r[3]; r[3] = l[7]; l[7] = t;
+}
+
+// v * fdtbl rounded half away from zero, like (int)(v < 0 ? v - 0.5f : v + 0.5f)
+static __m128i stbiw__jpg_quantize_sse2(__m128 v, const float* fdtbl)
+{
+    __m128 half;
+    v = _mm_mul_ps(v, _mm_loadu_ps(fdtbl));
+    half = _mm_or_ps(_mm_and_ps(v, _mm_set1_ps(-0.0f)), _mm_set1_ps(0.5f));
+    return _mm_cvttps_epi32(_mm_add_ps(v, half));
+}
+
+static void stbiw__jpg_fdct_quantize_sse2(const float* CDU, int du_stride, const float* fdtbl, int* out)
+{
+    __m128 l[8], r[8];
+    int i;
+    for (i = 0; i < 8; ++i) {
+        l[i] = _mm_loadu_ps(CDU + i * du_stride);
+        r[i] = _mm_loadu_ps(CDU + i * du_stride + 4);
+    }
+    // rows: transpose so that each vector holds one column, then transpose back for the columns
+    stbiw__jpg_transpose_sse2(l, r);
+    STBIW__JPG_DCT_SSE2(l);
+    STBIW__JPG_DCT_SSE2(r);
+    stbiw__jpg_transpose_sse2(l, r);
+    STBIW__JPG_DCT_SSE2(l);
+    STBIW__JPG_DCT_SSE2(r);
+    for (i = 0; i < 8; ++i) {
+        _mm_storeu_si128((__m128i*)(out + i * 8), stbiw__jpg_quantize_sse2(l[i], fdtbl + i * 8));
+        _mm_storeu_si128((__m128i*)(out + i * 8 + 4), stbiw__jpg_quantize_sse2(r[i], fdtbl + i * 8 + 4));
+    }
+}
+
+static void stbiw__jpg_ycbcr_sse2(__m128 r, __m128 g, __m128 b, float* Y, float* U, float* V)
+{
+    _mm_storeu_ps(Y, _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(+0.29900f), r), _mm_mul_ps(_mm_set1_ps(0.58700f), g)), _mm_mul_ps(_mm_set1_ps(0.11400f), b)), _mm_set1_ps(128.0f)));
+    _mm_storeu_ps(U, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(-0.16874f), r), _mm_mul_ps(_mm_set1_ps(0.33126f), g)), _mm_mul_ps(_mm_set1_ps(0.50000f), b)));
+    _mm_storeu_ps(V, _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(_mm_set1_ps(+0.50000f), r), _mm_mul_ps(_mm_set1_ps(0.41869f), g)), _mm_mul_ps(_mm_set1_ps(0.08131f), b)));
+}
+
+// 4 RGBA pixels at a time; 3-component pixels need a byte shuffle, which SSE2 doesn't have
+static int stbiw__jpg_rgb_to_ycbcr_sse2(const unsigned char* p, int comp, int count, float* Y, float* U, float* V)
+{
+    const __m128i mask = _mm_set1_epi32(0xFF);
+    int i = 0;
+    if (comp != 4)
+        return 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i*)(p + i * 4));
+        __m128 r = _mm_cvtepi32_ps(_mm_and_si128(px, mask));
+        __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 8), mask));
+        __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(px, 16), mask));
+        stbiw__jpg_ycbcr_sse2(r, g, b, Y + i, U + i, V + i);
+    }
+    return i;
+}
+#endif
+
+#ifdef STBIW__AVX2
+#define STBIW__JPG_DCT_AVX2(d) do { \
+    __m256 tmp0 = _mm256_add_ps(d[0], d[7]), tmp7 = _mm256_sub_ps(d[0], d[7]); \
+    __m256 tmp1 = _mm256_add_ps(d[1], d[6]), tmp6 = _mm256_sub_ps(d[1], d[6]); \
+    __m256 tmp2 = _mm256_add_ps(d[2], d[5]), tmp5 = _mm256_sub_ps(d[2], d[5]); \
+    __m256 tmp3 = _mm256_add_ps(d[3], d[4]), tmp4 = _mm256_sub_ps(d[3], d[4]); \
+    __m256 tmp10 = _mm256_add_ps(tmp0, tmp3), tmp13 = _mm256_sub_ps(tmp0, tmp3); \
+    __m256 tmp11 = _mm256_add_ps(tmp1, tmp2), tmp12 = _mm256_sub_ps(tmp1, tmp2); \
+    __m256 z1, z2, z3, z4, z5, z11, z13; \
+    d[0] = _mm256_add_ps(tmp10, tmp11); \
+    d[4] = _mm256_sub_ps(tmp10, tmp11); \
+    z1 = _mm256_mul_ps(_mm256_add_ps(tmp12, tmp13), _mm256_set1_ps(0.707106781f)); \
+    d[2] = _mm256_add_ps(tmp13, z1); \
+    d[6] = _mm256_sub_ps(tmp13, z1); \
+    tmp10 = _mm256_add_ps(tmp4, tmp5); \
+    tmp11 = _mm256_add_ps(tmp5, tmp6); \
+    tmp12 = _mm256_add_ps(tmp6, tmp7); \
+    z5 = _mm256_mul_ps(_mm256_sub_ps(tmp10, tmp12), _mm256_set1_ps(0.382683433f)); \
+    z2 = _mm256_add_ps(_mm256_mul_ps(tmp10, _mm256_set1_ps(0.541196100f)), z5); \
+    z4 = _mm256_add_ps(_mm256_mul_ps(tmp12, _mm256_set1_ps(1.306562965f)), z5); \
+    z3 = _mm256_mul_ps(tmp11, _mm256_set1_ps(0.707106781f)); \
+    z11 = _mm256_add_ps(tmp7, z3); \
+    z13 = _mm256_sub_ps(tmp7, z3); \
+    d[5] = _mm256_add_ps(z13, z2); \
+    d[3] = _mm256_sub_ps(z13, z2); \
+    d[1] = _mm256_add_ps(z11, z4); \
+    d[7] = _mm256_sub_ps(z11, z4); \
+} while (0)
+
+STBIW__TARGET_AVX2 static void stbiw__jpg_transpose_avx2(__m256* d)
+{
+    __m256 t0 = _mm256_unpacklo_ps(d[0], d[1]), t1 = _mm256_unpackhi_ps(d[0], d[1]);
+    __m256 t2 = _mm256_unpacklo_ps(d[2], d[3]), t3 = _mm256_unpackhi_ps(d[2], d[3]);
+    __m256 t4 = _mm256_unpacklo_ps(d[4], d[5]), t5 = _mm256_unpackhi_ps(d[4], d[5]);
+    __m256 t6 = _mm256_unpacklo_ps(d[6], d[7]), t7 = _mm256_unpackhi_ps(d[6], d[7]);
+    __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    d[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+    d[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+    d[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+    d[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+    d[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+    d[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+    d[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+    d[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+STBIW__TARGET_AVX2 static void stbiw__jpg_fdct_quantize_avx2(const float* CDU, int du_stride, const float* fdtbl, int* out)
+{
+    __m256 d[8];
+    int i;
+    for (i = 0; i < 8; ++i)
+        d[i] = _mm256_loadu_ps(CDU + i * du_stride);
+    stbiw__jpg_transpose_avx2(d);
+    STBIW__JPG_DCT_AVX2(d);
+    stbiw__jpg_transpose_avx2(d);
+    STBIW__JPG_DCT_AVX2(d);
+    for (i = 0; i < 8; ++i) {
+        __m256 v = _mm256_mul_ps(d[i], _mm256_loadu_ps(fdtbl + i * 8));
+        __m256 half = _mm256_or_ps(_mm256_and_ps(v, _mm256_set1_ps(-0.0f)), _mm256_set1_ps(0.5f));
+        _mm256_storeu_si256((__m256i*)(out + i * 8), _mm256_cvttps_epi32(_mm256_add_ps(v, half)));
+    }
+}
+
+// 8 pixels at a time; 3-component pixels are spread out to 4 bytes with a shuffle first
+STBIW__TARGET_AVX2 static int stbiw__jpg_rgb_to_ycbcr_avx2(const unsigned char* p, int comp, int count, float* Y, float* U, float* V)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+    int i = 0;
+    if (comp < 3)
+        return 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i px;
+        __m256 r, g, b;
+        if (comp == 4) {
+            px = _mm256_loadu_si256((const __m256i*)(p + i * 4));
+        } else {
+            // pixels 0-3 from bytes 0-15 and pixels 4-7 from bytes 8-23, so nothing past the 8 pixels is read
+            __m128i lo = _mm_loadu_si128((const __m128i*)(p + i * 3));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(p + i * 3 + 8));
+            px = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), spread);
+        }
+        r = _mm256_cvtepi32_ps(_mm256_and_si256(px, mask));
+        g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 8), mask));
+        b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(px, 16), mask));
+        _mm256_storeu_ps(Y + i, _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(+0.29900f), r), _mm256_mul_ps(_mm256_set1_ps(0.58700f), g)), _mm256_mul_ps(_mm256_set1_ps(0.11400f), b)), _mm256_set1_ps(128.0f)));
+        _mm256_storeu_ps(U + i, _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(-0.16874f), r), _mm256_mul_ps(_mm256_set1_ps(0.33126f), g)), _mm256_mul_ps(_mm256_set1_ps(0.50000f), b)));
+        _mm256_storeu_ps(V + i, _mm256_sub_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(+0.50000f), r), _mm256_mul_ps(_mm256_set1_ps(0.41869f), g)), _mm256_mul_ps(_mm256_set1_ps(0.08131f), b)));
+    }
+    return i;
+}
+#endif
+
+#ifdef STBIW__NEON
+#define STBIW__JPG_DCT_NEON(d) do { \
+    float32x4_t tmp0 = vaddq_f32(d[0], d[7]), tmp7 = vsubq_f32(d[0], d[7]); \
+    float32x4_t tmp1 = vaddq_f32(d[1], d[6]), tmp6 = vsubq_f32(d[1], d[6]); \
+    float32x4_t tmp2 = vaddq_f32(d[2], d[5]), tmp5 = vsubq_f32(d[2], d[5]); \
+    float32x4_t tmp3 = vaddq_f32(d[3], d[4]), tmp4 = vsubq_f32(d[3], d[4]); \
+    float32x4_t tmp10 = vaddq_f32(tmp0, tmp3), tmp13 = vsubq_f32(tmp0, tmp3); \
+    float32x4_t tmp11 = vaddq_f32(tmp1, tmp2), tmp12 = vsubq_f32(tmp1, tmp2); \
+    float32x4_t z1, z2, z3, z4, z5, z11, z13; \
+    d[0] = vaddq_f32(tmp10, tmp11); \
+    d[4] = vsubq_f32(tmp10, tmp11); \
+    z1 = vmulq_n_f32(vaddq_f32(tmp12, tmp13), 0.707106781f); \
+    d[2] = vaddq_f32(tmp13, z1); \
+    d[6] = vsubq_f32(tmp13, z1); \
+    tmp10 = vaddq_f32(tmp4, tmp5); \
+    tmp11 = vaddq_f32(tmp5, tmp6); \
+    tmp12 = vaddq_f32(tmp6, tmp7); \
+    z5 = vmulq_n_f32(vsubq_f32(tmp10, tmp12), 0.382683433f); \
+    z2 = vaddq_f32(vmulq_n_f32(tmp10, 0.541196100f), z5); \
+    z4 = vaddq_f32(vmulq_n_f32(tmp12, 1.306562965f), z5); \
+    z3 = vmulq_n_f32(tmp11, 0.707106781f); \
+    z11 = vaddq_f32(tmp7, z3); \
+    z13 = vsubq_f32(tmp7, z3); \
+    d[5] = vaddq_f32(z13, z2); \
+    d[3] = vsubq_f32(z13, z2); \
+    d[1] = vaddq_f32(z11, z4); \
+    d[7] = vsubq_f32(z11, z4); \
+} while (0)
+
+static void stbiw__jpg_transpose4_neon(float32x4_t* a, float32x4_t* b, float32x4_t* c, float32x4_t* d)
+{
+    float32x4x2_t ab = vtrnq_f32(*a, *b), cd = vtrnq_f32(*c, *d);
+    *a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+    *b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+    *c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+    *d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+}
+
+// same layout as the SSE2 version: left (columns 0-3) and right (columns 4-7) halves of each row
+static void stbiw__jpg_transpose_neon(float32x4_t* l, float32x4_t* r)
+{
+    float32x4_t t;
+    int i;
+    stbiw__jpg_transpose4_neon(&l[0], &l[1], &l[2], &l[3]);
+    stbiw__jpg_transpose4_neon(&r[0], &r[1], &r[2], &r[3]);
+    stbiw__jpg_transpose4_neon(&l[4], &l[5], &l[6], &l[7]);
+    stbiw__jpg_transpose4_neon(&r[4], &r[5], &r[6], &r[7]);
+    for (i = 0; i < 4; ++i) {
+        t = r[i]; r[i] = l[i + 4]; l[i + 4] = t;
+    }
+}
+
+static int32x4_t stbiw__jpg_quantize_neon(float32x4_t v, const float* fdtbl)
+{
+    uint32x4_t half;
+    v = vmulq_f32(v, vld1q_f32(fdtbl));
+    half = vorrq_u32(vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000u)), vreinterpretq_u32_f32(vdupq_n_f32(0.5f)));
+    return vcvtq_s32_f32(vaddq_f32(v, vreinterpretq_f32_u32(half)));
+}
+
+static void stbiw__jpg_fdct_quantize_neon(const float* CDU, int du_stride, const float* fdtbl, int* out)
+{
+    float32x4_t l[8], r[8];
+    int i;
+    for (i = 0; i < 8; ++i) {
+        l[i] = vld1q_f32(CDU + i * du_stride);
+        r[i] = vld1q_f32(CDU + i * du_stride + 4);
+    }
+    stbiw__jpg_transpose_neon(l, r);
+    STBIW__JPG_DCT_NEON(l);
+    STBIW__JPG_DCT_NEON(r);
+    stbiw__jpg_transpose_neon(l, r);
+    STBIW__JPG_DCT_NEON(l);
+    STBIW__JPG_DCT_NEON(r);
+    for (i = 0; i < 8; ++i) {
+        vst1q_s32(out + i * 8, stbiw__jpg_quantize_neon(l[i], fdtbl + i * 8));
+        vst1q_s32(out + i * 8 + 4, stbiw__jpg_quantize_neon(r[i], fdtbl + i * 8 + 4));
+    }
+}
+
+static void stbiw__jpg_ycbcr_neon(uint16x4_t r16, uint16x4_t g16, uint16x4_t b16, float* Y, float* U, float* V)
+{
+    float32x4_t r = vcvtq_f32_u32(vmovl_u16(r16)), g = vcvtq_f32_u32(vmovl_u16(g16)), b = vcvtq_f32_u32(vmovl_u16(b16));
+    vst1q_f32(Y, vsubq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(r, +0.29900f), vmulq_n_f32(g, 0.58700f)), vmulq_n_f32(b, 0.11400f)), vdupq_n_f32(128.0f)));
+    vst1q_f32(U, vaddq_f32(vsubq_f32(vmulq_n_f32(r, -0.16874f), vmulq_n_f32(g, 0.33126f)), vmulq_n_f32(b, 0.50000f)));
+    vst1q_f32(V, vsubq_f32(vsubq_f32(vmulq_n_f32(r, +0.50000f), vmulq_n_f32(g, 0.41869f)), vmulq_n_f32(b, 0.08131f)));
+}
+
+// 8 pixels at a time; vld3/vld4 take the components apart
+static int stbiw__jpg_rgb_to_ycbcr_neon(const unsigned char* p, int comp, int count, float* Y, float* U, float* V)
+{
+    int i = 0;
+    if (comp < 3)
+        return 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t r, g, b;
+        if (comp == 4) {
+            uint8x8x4_t px = vld4_u8(p + i * 4);
+            r = vmovl_u8(px.val[0]); g = vmovl_u8(px.val[1]); b = vmovl_u8(px.val[2]);
+        } else {
+            uint8x8x3_t px = vld3_u8(p + i * 3);
+            r = vmovl_u8(px.val[0]); g = vmovl_u8(px.val[1]); b = vmovl_u8(px.val[2]);
+        }
+        stbiw__jpg_ycbcr_neon(vget_low_u16(r), vget_low_u16(g), vget_low_u16(b), Y + i, U + i, V + i);
+        stbiw__jpg_ycbcr_neon(vget_high_u16(r), vget_high_u16(g), vget_high_u16(b), Y + i + 4, U + i + 4, V + i + 4);
+    }
+    return i;
+}
+#endif
+
+// DCT and quantize one 8x8 block; out[] is in row order (not zigzagged yet). The scalar path
+// transforms CDU in place, the SIMD paths leave it as it was.
+static void stbiw__jpg_fdct_quantize(int simd_level, float* CDU, int du_stride, const float* fdtbl, int* out)
+{
+    int dataOff, n, x, y, i, j;
+#ifdef STBIW__AVX2
+    if (simd_level >= STBIW__SIMD_AVX2) {
+        stbiw__jpg_fdct_quantize_avx2(CDU, du_stride, fdtbl, out);
+        return;
+    }
+#endif
+#ifdef STBIW__SSE2
+    if (simd_level >= STBIW__SIMD_SSE2) {
+        stbiw__jpg_fdct_quantize_sse2(CDU, du_stride, fdtbl, out);
+        return;
+    }
+#endif
+#ifdef STBIW__NEON
+    if (simd_level >= STBIW__SIMD_SSE2) {
+        stbiw__jpg_fdct_quantize_neon(CDU, du_stride, fdtbl, out);
+        return;
+    }
+#endif
+    (void)simd_level;
 
     // DCT rows
     for (dataOff = 0, n = du_stride * 8; dataOff < n; dataOff += du_stride) {
@@ -1356,17 +2742,49 @@ static int stbiw__jpg_processDU(stbi__write_context* s, int* bitBuf, int* bitCnt
         stbiw__jpg_DCT(&CDU[dataOff], &CDU[dataOff + du_stride], &CDU[dataOff + du_stride * 2], &CDU[dataOff + du_stride * 3], &CDU[dataOff + du_stride * 4],
             &CDU[dataOff + du_stride * 5], &CDU[dataOff + du_stride * 6], &CDU[dataOff + du_stride * 7]);
     }
-    // Quantize/descale/zigzag the coefficients
+    // Quantize/descale the coefficients
     for (y = 0, j = 0; y < 8; ++y) {
         for (x = 0; x < 8; ++x, ++j) {
             float v;
             i = y * du_stride + x;
             v = CDU[i] * fdtbl[j];
-            // DU[stbiw__jpg_ZigZag[j]] = (int)(v < 0 ? ceilf(v - 0.5f) : floorf(v + 0.5f));
+            // out[j] = (int)(v < 0 ? ceilf(v - 0.5f) : floorf(v + 0.5f));
             // ceilf() and floorf() are C99, not C89, but I /think/ they're not needed here anyway?
-            DU[stbiw__jpg_ZigZag[j]] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
+            out[j] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
         }
     }
+}
+
+// Convert count pixels of one row to Y, Cb and Cr; returns how many were done (the rest is left to the scalar loop)
+static int stbiw__jpg_rgb_to_ycbcr_simd(int simd_level, const unsigned char* p, int comp, int count, float* Y, float* U, float* V)
+{
+#ifdef STBIW__AVX2
+    if (simd_level >= STBIW__SIMD_AVX2)
+        return stbiw__jpg_rgb_to_ycbcr_avx2(p, comp, count, Y, U, V);
+#endif
+#ifdef STBIW__SSE2
+    if (simd_level >= STBIW__SIMD_SSE2)
+        return stbiw__jpg_rgb_to_ycbcr_sse2(p, comp, count, Y, U, V);
+#endif
+#ifdef STBIW__NEON
+    if (simd_level >= STBIW__SIMD_SSE2)
+        return stbiw__jpg_rgb_to_ycbcr_neon(p, comp, count, Y, U, V);
+#endif
+    (void)simd_level; (void)p; (void)comp; (void)count; (void)Y; (void)U; (void)V;
+    return 0;
+}
+
+static int stbiw__jpg_processDU(stbi__write_context* s, int* bitBuf, int* bitCnt, float* CDU, int du_stride, const float* fdtbl, int DC, const unsigned short HTDC[256][2], const unsigned short HTAC[256][2], int simd_level) {
+    const unsigned short EOB[2] = { HTAC[0x00][0], HTAC[0x00][1] };
+    const unsigned short M16zeroes[2] = { HTAC[0xF0][0], HTAC[0xF0][1] };
+    int i, j, diff, end0pos;
+    int DU[64], coefficients[64];
+
+    stbiw__jpg_fdct_quantize(simd_level, CDU, du_stride, fdtbl, coefficients);
+    // zigzag the coefficients
+    for (j = 0; j < 64; ++j) {
+        DU[stbiw__jpg_ZigZag[j]] = coefficients[j];
+    }
 
     // Encode DC
     diff = DU[0] - DC;
@@ -1412,6 +2830,155 @@ static int stbiw__jpg_processDU(stbi__write_context* s, int* bitBuf, int* bitCnt
     return DU[0];
 }
 
+// The image and tables the 8x8 block encoder works from; read-only, so the bands of a parallel encode share it
+typedef struct
+{
+    const unsigned char* data;
+    int width, height, comp, subsample, simd_level;
+    float fdtbl_Y[64], fdtbl_UV[64];
+    const unsigned short (*YDC_HT)[2];
+    const unsigned short (*UVDC_HT)[2];
+    const unsigned short (*YAC_HT)[2];
+    const unsigned short (*UVAC_HT)[2];
+} stbiw__jpg_image;
+
+// Encode the MCU rows starting in [y_begin, y_end) as one entropy-coded segment: the DC predictions
+// start from zero and the last byte is padded with 1 bits, as required before an RST or EOI marker.
+static void stbiw__jpg_encode_rows(stbi__write_context* s, const stbiw__jpg_image* img, int y_begin, int y_end)
+{
+    static const unsigned short fillBits[] = { 0x7F, 7 };
+    int DCY = 0, DCU = 0, DCV = 0;
+    int bitBuf = 0, bitCnt = 0;
+    int width = img->width, height = img->height, comp = img->comp, simd_level = img->simd_level;
+    const float* fdtbl_Y = img->fdtbl_Y;
+    const float* fdtbl_UV = img->fdtbl_UV;
+    const unsigned short (*YDC_HT)[2] = img->YDC_HT, (*UVDC_HT)[2] = img->UVDC_HT;
+    const unsigned short (*YAC_HT)[2] = img->YAC_HT, (*UVAC_HT)[2] = img->UVAC_HT;
+    // comp == 2 is grey+alpha (alpha is ignored)
+    int ofsG = comp > 2 ? 1 : 0, ofsB = comp > 2 ? 2 : 0;
+    const unsigned char* dataR = img->data;
+    const unsigned char* dataG = dataR + ofsG;
+    const unsigned char* dataB = dataR + ofsB;
+    int x, y, row, col, pos;
+    if (img->subsample) {
+        for (y = y_begin; y < y_end; y += 16) {
+            for (x = 0; x < width; x += 16) {
+                float Y[256], U[256], V[256];
+                for (row = y, pos = 0; row < y + 16; ++row) {
+                    // row >= height => use last input row
+                    int clamped_row = (row < height) ? row : height - 1;
+                    int base_p = (stbi__flip_vertically_on_write ? (height - 1 - clamped_row) : clamped_row) * width * comp;
+                    // the pixels inside the image go through the SIMD conversion, the clamped ones past the right edge don't
+                    int done = stbiw__jpg_rgb_to_ycbcr_simd(simd_level, dataR + base_p + x * comp, comp, width - x < 16 ? width - x : 16, Y + pos, U + pos, V + pos);
+                    for (col = x + done, pos += done; col < x + 16; ++col, ++pos) {
+                        // if col >= width => use pixel from last input column
+                        int p = base_p + ((col < width) ? col : (width - 1)) * comp;
+                        float r = dataR[p], g = dataG[p], b = dataB[p];
+                        Y[pos] = +0.29900f * r + 0.58700f * g + 0.11400f * b - 128;
+                        U[pos] = -0.16874f * r - 0.33126f * g + 0.50000f * b;
+                        V[pos] = +0.50000f * r - 0.41869f * g - 0.08131f * b;
+                    }
+                }
+                DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 0, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT, simd_level);
+                DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 8, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT, simd_level);
+                DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 128, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT, simd_level);
+                DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 136, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT, simd_level);
+
+                // subsample U,V
+                {
+                    float subU[64], subV[64];
+                    int yy, xx;
+                    for (yy = 0, pos = 0; yy < 8; ++yy) {
+                        for (xx = 0; xx < 8; ++xx, ++pos) {
+                            int j = yy * 32 + xx * 2;
+                            subU[pos] = (U[j + 0] + U[j + 1] + U[j + 16] + U[j + 17]) * 0.25f;
+                            subV[pos] = (V[j + 0] + V[j + 1] + V[j + 16] + V[j + 17]) * 0.25f;
+                        }
+                    }
+                    DCU = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, subU, 8, fdtbl_UV, DCU, UVDC_HT, UVAC_HT, simd_level);
+                    DCV = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, subV, 8, fdtbl_UV, DCV, UVDC_HT, UVAC_HT, simd_level);
+                }
+            }
+        }
+    }
+    else {
+        for (y = y_begin; y < y_end; y += 8) {
+            for (x = 0; x < width; x += 8) {
+                float Y[64], U[64], V[64];
+                for (row = y, pos = 0; row < y + 8; ++row) {
+                    // row >= height => use last input row
+                    int clamped_row = (row < height) ? row : height - 1;
+                    int base_p = (stbi__flip_vertically_on_write ? (height - 1 - clamped_row) : clamped_row) * width * comp;
+                    // the pixels inside the image go through the SIMD conversion, the clamped ones past the right edge don't
+                    int done = stbiw__jpg_rgb_to_ycbcr_simd(simd_level, dataR + base_p + x * comp, comp, width - x < 8 ? width - x : 8, Y + pos, U + pos, V + pos);
+                    for (col = x + done, pos += done; col < x + 8; ++col, ++pos) {
+                        // if col >= width => use pixel from last input column
+                        int p = base_p + ((col < width) ? col : (width - 1)) * comp;
+                        float r = dataR[p], g = dataG[p], b = dataB[p];
+                        Y[pos] = +0.29900f * r + 0.58700f * g + 0.11400f * b - 128;
+                        U[pos] = -0.16874f * r - 0.33126f * g + 0.50000f * b;
+                        V[pos] = +0.50000f * r - 0.41869f * g - 0.08131f * b;
+                    }
+                }
+
+                DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y, 8, fdtbl_Y, DCY, YDC_HT, YAC_HT, simd_level);
+                DCU = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, U, 8, fdtbl_UV, DCU, UVDC_HT, UVAC_HT, simd_level);
+                DCV = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, V, 8, fdtbl_UV, DCV, UVDC_HT, UVAC_HT, simd_level);
+            }
+        }
+    }
+
+    // Do the bit alignment of the EOI (or RST) marker
+    stbiw__jpg_writeBits(s, &bitBuf, &bitCnt, fillBits);
+}
+
+// the output of one band of a parallel stbi_write_jpg
+typedef struct
+{
+    unsigned char* data;
+    int size, capacity, failed;
+} stbiw__jpg_band;
+
+typedef struct
+{
+    const stbiw__jpg_image* image;
+    int band_height;
+    stbiw__jpg_band* bands;
+} stbiw__jpg_bands;
+
+static void stbiw__jpg_band_write(void* context, void* data, int size)
+{
+    stbiw__jpg_band* band = (stbiw__jpg_band*)context;
+    if (band->failed)
+        return;
+    if (band->size + size > band->capacity) {
+        int capacity = band->capacity ? band->capacity * 2 : 65536;
+        unsigned char* grown;
+        while (capacity < band->size + size)
+            capacity *= 2;
+        grown = (unsigned char*)STBIW_REALLOC_SIZED(band->data, band->capacity, capacity);
+        if (grown == NULL) {
+            band->failed = 1;
+            return;
+        }
+        band->data = grown;
+        band->capacity = capacity;
+    }
+    memcpy(band->data + band->size, data, size);
+    band->size += size;
+}
+
+static void stbiw__jpg_encode_band(void* context, int index)
+{
+    stbiw__jpg_bands* c = (stbiw__jpg_bands*)context;
+    stbi__write_context s = { 0 };
+    int y_begin = index * c->band_height;
+    int y_end = y_begin + c->band_height < c->image->height ? y_begin + c->band_height : c->image->height;
+    stbi__start_write_callbacks(&s, stbiw__jpg_band_write, &c->bands[index]);
+    stbiw__jpg_encode_rows(&s, c->image, y_begin, y_end);
+    stbiw__write_flush(&s);
+}
+
 static int stbi_write_jpg_core(stbi__write_context* s, int width, int height, int comp, const void* data, int quality) {
     // Constants that don't pollute global namespace
     static const unsigned char std_dc_luminance_nrcodes[] = { 0,0,1,5,1,1,1,1,1,1,0,0,0,0,0,0,0 };
@@ -1484,9 +3051,9 @@ static int stbi_write_jpg_core(stbi__write_context* s, int width, int height, in
     static const float aasf[] = { 1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f, 1.175875602f * 2.828427125f,
                                   1.0f * 2.828427125f, 0.785694958f * 2.828427125f, 0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f };
 
-    int row, col, i, k, subsample;
-    float fdtbl_Y[64], fdtbl_UV[64];
+    int row, col, i, k, subsample, mcu_size, mcus_per_row, band_height, band_count;
     unsigned char YTable[64], UVTable[64];
+    stbiw__jpg_image image;
 
     if (!data || !width || !height || comp > 4 || comp < 1) {
         return 0;
@@ -1506,11 +3073,33 @@ static int stbi_write_jpg_core(stbi__write_context* s, int width, int height, in
 
     for (row = 0, k = 0; row < 8; ++row) {
         for (col = 0; col < 8; ++col, ++k) {
-            fdtbl_Y[k] = 1 / (YTable[stbiw__jpg_ZigZag[k]] * aasf[row] * aasf[col]);
-            fdtbl_UV[k] = 1 / (UVTable[stbiw__jpg_ZigZag[k]] * aasf[row] * aasf[col]);
+            image.fdtbl_Y[k] = 1 / (YTable[stbiw__jpg_ZigZag[k]] * aasf[row] * aasf[col]);
+            image.fdtbl_UV[k] = 1 / (UVTable[stbiw__jpg_ZigZag[k]] * aasf[row] * aasf[col]);
         }
     }
 
+    image.data = (const unsigned char*)data;
+    image.width = width;
+    image.height = height;
+    image.comp = comp;
+    image.subsample = subsample;
+    image.simd_level = stbiw__simd_level();
+    image.YDC_HT = YDC_HT;
+    image.UVDC_HT = UVDC_HT;
+    image.YAC_HT = YAC_HT;
+    image.UVAC_HT = UVAC_HT;
+
+    // With a parallel-for installed, the image is cut into bands of stbi_write_jpg_band_rows MCU rows that
+    // are entropy coded concurrently; the restart interval (in MCUs) has to fit in the 16 bits of DRI.
+    mcu_size = subsample ? 16 : 8;
+    mcus_per_row = (width + mcu_size - 1) / mcu_size;
+    band_height = height;
+    if (stbiw__parallel_for && stbi_write_jpg_band_rows > 0) {
+        int band_rows = stbi_write_jpg_band_rows < 65535 / mcus_per_row ? stbi_write_jpg_band_rows : 65535 / mcus_per_row;
+        band_height = (band_rows > 0 ? band_rows : 1) * mcu_size;
+    }
+    band_count = (height + band_height - 1) / band_height;
+
     // Write Headers
     {
         static const unsigned char head0[] = { 0xFF,0xD8,0xFF,0xE0,0,0x10,'J','F','I','F',0,1,1,0,0,1,0,1,0,0,0xFF,0xDB,0,0x84,0 };
@@ -1533,86 +3122,45 @@ static int stbi_write_jpg_core(stbi__write_context* s, int width, int height, in
         stbiw__putc(s, 0x11); // HTUACinfo
         s->func(s->context, (void*)(std_ac_chrominance_nrcodes + 1), sizeof(std_ac_chrominance_nrcodes) - 1);
         s->func(s->context, (void*)std_ac_chrominance_values, sizeof(std_ac_chrominance_values));
+        if (band_count > 1) {
+            int interval = band_height / mcu_size * mcus_per_row;
+            const unsigned char dri[] = { 0xFF,0xDD,0,4,(unsigned char)(interval >> 8),STBIW_UCHAR(interval) };
+            s->func(s->context, (void*)dri, sizeof(dri));
+        }
         s->func(s->context, (void*)head2, sizeof(head2));
     }
 
     // Encode 8x8 macroblocks
-    {
-        static const unsigned short fillBits[] = { 0x7F, 7 };
-        int DCY = 0, DCU = 0, DCV = 0;
-        int bitBuf = 0, bitCnt = 0;
-        // comp == 2 is grey+alpha (alpha is ignored)
-        int ofsG = comp > 2 ? 1 : 0, ofsB = comp > 2 ? 2 : 0;
-        const unsigned char* dataR = (const unsigned char*)data;
-        const unsigned char* dataG = dataR + ofsG;
-        const unsigned char* dataB = dataR + ofsB;
-        int x, y, pos;
-        if (subsample) {
-            for (y = 0; y < height; y += 16) {
-                for (x = 0; x < width; x += 16) {
-                    float Y[256], U[256], V[256];
-                    for (row = y, pos = 0; row < y + 16; ++row) {
-                        // row >= height => use last input row
-                        int clamped_row = (row < height) ? row : height - 1;
-                        int base_p = (stbi__flip_vertically_on_write ? (height - 1 - clamped_row) : clamped_row) * width * comp;
-                        for (col = x; col < x + 16; ++col, ++pos) {
-                            // if col >= width => use pixel from last input column
-                            int p = base_p + ((col < width) ? col : (width - 1)) * comp;
-                            float r = dataR[p], g = dataG[p], b = dataB[p];
-                            Y[pos] = +0.29900f * r + 0.58700f * g + 0.11400f * b - 128;
-                            U[pos] = -0.16874f * r - 0.33126f * g + 0.50000f * b;
-                            V[pos] = +0.50000f * r - 0.41869f * g - 0.08131f * b;
-                        }
-                    }
-                    DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 0, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT);
-                    DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 8, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT);
-                    DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 128, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT);
-                    DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y + 136, 16, fdtbl_Y, DCY, YDC_HT, YAC_HT);
-
-                    // subsample U,V
-                    {
-                        float subU[64], subV[64];
-                        int yy, xx;
-                        for (yy = 0, pos = 0; yy < 8; ++yy) {
-                            for (xx = 0; xx < 8; ++xx, ++pos) {
-                                int j = yy * 32 + xx * 2;
-                                subU[pos] = (U[j + 0] + U[j + 1] + U[j + 16] + U[j + 17]) * 0.25f;
-                                subV[pos] = (V[j + 0] + V[j + 1] + V[j + 16] + V[j + 17]) * 0.25f;
-                            }
-                        }
-                        DCU = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, subU, 8, fdtbl_UV, DCU, UVDC_HT, UVAC_HT);
-                        DCV = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, subV, 8, fdtbl_UV, DCV, UVDC_HT, UVAC_HT);
-                    }
+    if (band_count > 1) {
+        // each band is a restart interval, encoded on its own and joined with RSTn markers
+        stbiw__jpg_bands c;
+        int failed = 0;
+        c.image = &image;
+        c.band_height = band_height;
+        c.bands = (stbiw__jpg_band*)STBIW_MALLOC(band_count * sizeof(stbiw__jpg_band));
+        if (c.bands == NULL)
+            return 0;
+        memset(c.bands, 0, band_count * sizeof(stbiw__jpg_band));
+
+        stbiw__parallel_for(stbiw__parallel_for_context, band_count, stbiw__jpg_encode_band, &c);
+
+        for (i = 0; i < band_count; ++i) {
+            failed |= c.bands[i].failed;
+            if (!failed) {
+                s->func(s->context, c.bands[i].data, c.bands[i].size);
+                if (i < band_count - 1) {
+                    stbiw__putc(s, 0xFF);
+                    stbiw__putc(s, (unsigned char)(0xD0 + (i & 7)));
                 }
             }
+            STBIW_FREE(c.bands[i].data);
         }
-        else {
-            for (y = 0; y < height; y += 8) {
-                for (x = 0; x < width; x += 8) {
-                    float Y[64], U[64], V[64];
-                    for (row = y, pos = 0; row < y + 8; ++row) {
-                        // row >= height => use last input row
-                        int clamped_row = (row < height) ? row : height - 1;
-                        int base_p = (stbi__flip_vertically_on_write ? (height - 1 - clamped_row) : clamped_row) * width * comp;
-                        for (col = x; col < x + 8; ++col, ++pos) {
-                            // if col >= width => use pixel from last input column
-                            int p = base_p + ((col < width) ? col : (width - 1)) * comp;
-                            float r = dataR[p], g = dataG[p], b = dataB[p];
-                            Y[pos] = +0.29900f * r + 0.58700f * g + 0.11400f * b - 128;
-                            U[pos] = -0.16874f * r - 0.33126f * g + 0.50000f * b;
-                            V[pos] = +0.50000f * r - 0.41869f * g - 0.08131f * b;
-                        }
-                    }
-
-                    DCY = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, Y, 8, fdtbl_Y, DCY, YDC_HT, YAC_HT);
-                    DCU = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, U, 8, fdtbl_UV, DCU, UVDC_HT, UVAC_HT);
-                    DCV = stbiw__jpg_processDU(s, &bitBuf, &bitCnt, V, 8, fdtbl_UV, DCV, UVDC_HT, UVAC_HT);
-                }
-            }
-        }
-
-        // Do the bit alignment of the EOI marker
-        stbiw__jpg_writeBits(s, &bitBuf, &bitCnt, fillBits);
+        STBIW_FREE(c.bands);
+        if (failed)
+            return 0;
+    }
+    else {
+        stbiw__jpg_encode_rows(s, &image, 0, height);
     }
 
     // EOI
@@ -0,0 +1,39 @@
+# Converts a SPIR-V binary into a C++ header with a constexpr uint32_t array.
+#
+# Usage: cmake -DINPUT=<file.spv> -DOUTPUT=<file.h> -DNAME=<array name> -P EmbedSpirv.cmake
+
+if(NOT INPUT OR NOT OUTPUT OR NOT NAME)
+  message(FATAL_ERROR "EmbedSpirv.cmake requires INPUT, OUTPUT and NAME")
+endif()
+
+file(READ "${INPUT}" spirv_hex HEX)
+string(LENGTH "${spirv_hex}" spirv_hex_length)
+math(EXPR spirv_word_remainder "${spirv_hex_length} % 8")
+if(spirv_hex_length EQUAL 0 OR NOT spirv_word_remainder EQUAL 0)
+  message(FATAL_ERROR "${INPUT} is not a SPIR-V binary (size must be a multiple of 4 bytes)")
+endif()
+
+# SPIR-V words are little-endian: reverse the bytes of each word, 8 words per line.
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+       "0x\\4\\3\\2\\1, " spirv_words "${spirv_hex}")
+string(REPEAT "0x[0-9a-f]+, " 8 spirv_line_pattern)
+string(REGEX REPLACE "(${spirv_line_pattern})" "\\1\n    " spirv_words "${spirv_words}")
+string(REGEX REPLACE ", \n    " ",\n    " spirv_words "${spirv_words}")
+string(REGEX REPLACE "[ \n]+$" "" spirv_words "${spirv_words}")
+
+get_filename_component(input_name "${INPUT}" NAME)
+
+file(WRITE "${OUTPUT}.tmp"
+"// Generated from ${input_name} by cmake/EmbedSpirv.cmake. Do not edit.
+#pragma once
+
+#include <cstdint>
+
+constexpr uint32_t ${NAME}[] = {
+    ${spirv_words}
+};
+")
+
+# Leave the header untouched when the content is the same, to avoid needless rebuilds.
+configure_file("${OUTPUT}.tmp" "${OUTPUT}" COPYONLY)
+file(REMOVE "${OUTPUT}.tmp")